@@ -15,4 +15,13 @@
 #define TIMER_RULE_ERROR(Args...) \
             ::xg::timer::Log::Error("RULE", Args)
 
+#define TIMER_CLOCK_INFO(Args...) \
+            ::xg::timer::Log::Info("CLOCK", Args)
+
+#define TIMER_WHEEL_INFO(Args...) \
+            ::xg::timer::Log::Info("WHEEL", Args)
+
+#define TIMER_WHEEL_ERROR(Args...) \
+            ::xg::timer::Log::Error("WHEEL", Args)
+
 #endif
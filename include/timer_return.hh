@@ -72,6 +72,10 @@ public:
         ESCHEDULE_RULE_INVALID,
         ESCHEDULE_RULE_CONFLICT,
         ESCHEDULE_RULE_REACH_LIMIT,
+
+        EWHEEL_NOT_RUNNING,
+        EWHEEL_TASK_INVALID,
+        EWHEEL_GROUP_CANCELLED,
     };
 public:
     Return(int ecode) : _ecode(ecode), _exception(Exception::Instance()) {
@@ -84,6 +88,10 @@ public:
                 { Return::ErrCode::ESCHEDULE_RULE_INVALID, "Bad scheduling rule." },
                 { Return::ErrCode::ESCHEDULE_RULE_CONFLICT, "Conflict scheduling rule." },
                 { Return::ErrCode::ESCHEDULE_RULE_REACH_LIMIT, "Reach scheduling rule limit." },
+
+                { Return::ErrCode::EWHEEL_NOT_RUNNING, "Wheel worker not running." },
+                { Return::ErrCode::EWHEEL_TASK_INVALID, "Bad wheel task." },
+                { Return::ErrCode::EWHEEL_GROUP_CANCELLED, "Timer group cancelled." },
             });
         }
     }
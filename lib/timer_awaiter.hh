@@ -0,0 +1,80 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-23 10:20
+ * @file     : timer_awaiter.hh
+ * @brief    : Awaitable timers for C++20 coroutines.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_AWAITER_HH__
+#define __TIMER_AWAITER_HH__
+
+#include <coroutine>
+
+#include "timer_return.hh"
+#include "timer_task.hh"
+#include "timer_wheel_worker.hh"
+
+namespace xg::timer {
+
+/**
+* @brief - Awaiter suspending a coroutine until a wheel time or the next
+*          fire of a rule. The task is embedded in the awaiter, which lives
+*          in the coroutine frame, and the coroutine handle is its payload:
+*          a wait allocates nothing. The coroutine is resumed on the wheel
+*          worker thread and must stay alive while suspended.
+*          co_await yields a tuple of Return class & fire wall time.
+*/
+class TimerAwaiter {
+public:
+    TimerAwaiter(WheelWorker& worker, const Clock::TimePoint& deadline)
+            : _worker(worker), _task(deadline), _ret(Return::SUCCESS) { }
+    TimerAwaiter(WheelWorker& worker, TaskRule rule, Return ret = Return::SUCCESS)
+            : _worker(worker), _task(std::move(rule), Task::Callback(), false), _ret(ret) { }
+    TimerAwaiter(const TimerAwaiter&) = delete;
+    TimerAwaiter& operator=(const TimerAwaiter&) = delete;
+
+    bool await_ready() {
+        if (_ret != Return::SUCCESS) {
+            return true;
+        }
+        return (!_task._rule && _task._deadline <= Clock::Instance().Cached());
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        _task._handle = handle;
+        // Non owning reference, the task lives in the coroutine frame.
+        Return ret = _worker.Add(std::shared_ptr<Task>(std::shared_ptr<Task>(), &_task));
+        if (ret != Return::SUCCESS) {
+            _ret = ret;
+            return false;
+        }
+        // May already be resumed on the worker thread, touch nothing here.
+        return true;
+    }
+
+    std::tuple<Return, Rule::RefTimePoint> await_resume() {
+        if (_ret != Return::SUCCESS) {
+            return {_ret, Rule::RefTimePoint()};
+        }
+        if (!_task._rule && !_task._handle) {
+            // Ready without suspending.
+            return {Return::SUCCESS, Clock::Instance().ToWall(_task._deadline)};
+        }
+        if (!_task._fired) {
+            return {Return::ESCHEDULE_RULE_REACH_LIMIT, Rule::RefTimePoint()};
+        }
+        return {Return::SUCCESS, _task._walltime};
+    }
+
+private:
+    WheelWorker& _worker;
+    Task _task;
+    Return _ret;
+};
+
+}
+
+#endif
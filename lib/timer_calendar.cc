@@ -0,0 +1,147 @@
+#include "timer_calendar.hh"
+
+namespace xg::timer {
+
+Calendar::Calendar(const Rule::RefTimePoint& time)
+{
+    auto curr_days = std::chrono::floor<std::chrono::days>(time);
+    std::chrono::year_month_day ymd(curr_days);
+    std::chrono::hh_mm_ss curr_time(std::chrono::floor<std::chrono::seconds>(time - curr_days));
+
+    _days = curr_days.time_since_epoch().count();
+    _year = (int)ymd.year();
+    _month = (unsigned int)ymd.month();
+    _day = (unsigned int)ymd.day();
+    _weekday = weekday_(_days);
+    _first_weekday = (_weekday - 1 - (_day - 1) % 7 + 7) % 7 + 1;
+    _month_days = GetMonthDays(_year, _month);
+    _hour = curr_time.hours().count();
+    _minute = curr_time.minutes().count();
+    _second = curr_time.seconds().count();
+}
+
+Rule::RefTimePoint Calendar::GetTimePoint() const
+{
+    return Rule::RefTimePoint(std::chrono::days(_days)
+                + std::chrono::hours(_hour)
+                + std::chrono::minutes(_minute)
+                + std::chrono::seconds(_second));
+}
+
+void Calendar::reset_time_()
+{
+    _hour = 0;
+    _minute = 0;
+    _second = 0;
+}
+
+Calendar& Calendar::SetYear(int year)
+{
+    if (year == _year) {
+        return (*this);
+    }
+    std::chrono::sys_days first_days = std::chrono::year(year) / 1 / 1;
+    _days = first_days.time_since_epoch().count();
+    _year = year;
+    _month = 1;
+    _day = 1;
+    _weekday = weekday_(_days);
+    _first_weekday = _weekday;
+    _month_days = GetMonthDays(_year, _month);
+    reset_time_();
+    return (*this);
+}
+
+Calendar& Calendar::SetMonth(int month)
+{
+    while (_month < month) {
+        NextMonth();
+    }
+    return (*this);
+}
+
+Calendar& Calendar::SetDayOfMonth(int day)
+{
+    if (day != _day) {
+        _days += day - _day;
+        _weekday = (_weekday - 1 + day - _day) % 7 + 1;
+        _day = day;
+    }
+    reset_time_();
+    return (*this);
+}
+
+Calendar& Calendar::SetHour(int hour)
+{
+    _hour = hour;
+    _minute = 0;
+    _second = 0;
+    return (*this);
+}
+
+Calendar& Calendar::SetMinute(int minute)
+{
+    _minute = minute;
+    _second = 0;
+    return (*this);
+}
+
+Calendar& Calendar::SetSecond(int second)
+{
+    _second = second;
+    return (*this);
+}
+
+Calendar& Calendar::NextYear()
+{
+    return SetYear(_year + 1);
+}
+
+Calendar& Calendar::NextMonth()
+{
+    _days += _month_days - _day + 1;
+    _first_weekday = (_first_weekday - 1 + _month_days) % 7 + 1;
+    _weekday = _first_weekday;
+    _day = 1;
+    if (++_month > 12) {
+        _month = 1;
+        ++_year;
+    }
+    _month_days = GetMonthDays(_year, _month);
+    reset_time_();
+    return (*this);
+}
+
+Calendar& Calendar::NextDay()
+{
+    if (_day >= _month_days) {
+        return NextMonth();
+    }
+    return SetDayOfMonth(_day + 1);
+}
+
+Calendar& Calendar::NextHour()
+{
+    if (_hour >= 23) {
+        return NextDay();
+    }
+    return SetHour(_hour + 1);
+}
+
+Calendar& Calendar::NextMinute()
+{
+    if (_minute >= 59) {
+        return NextHour();
+    }
+    return SetMinute(_minute + 1);
+}
+
+Calendar& Calendar::NextSecond()
+{
+    if (_second >= 59) {
+        return NextMinute();
+    }
+    return SetSecond(_second + 1);
+}
+
+}
@@ -0,0 +1,130 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-06 10:12
+ * @file     : timer_calendar.hh
+ * @brief    : Decomposed civil calendar used by rule evaluation.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_CALENDAR_HH__
+#define __TIMER_CALENDAR_HH__
+
+#include <chrono>
+
+#include "timer_rule.hh"
+
+namespace xg::timer {
+
+/**
+* @brief - Decomposed civil calendar time.
+*          The civil conversion is done once on construction, afterwards
+*          every field is advanced incrementally from the month table.
+*          Day of week uses ISO encoding (Monday = 1 ... Sunday = 7).
+*/
+class Calendar {
+public:
+    Calendar(const Rule::RefTimePoint& time);
+    Calendar(const Calendar& other) = default;
+    ~Calendar() { }
+
+    /**
+    * @brief GetTimePoint - Compose the calendar back to a time point.
+    *
+    * @returns  Time point accurate to seconds.
+    */
+    Rule::RefTimePoint GetTimePoint() const;
+
+    int GetYear() const { return _year; }
+    int GetMonth() const { return _month; }
+    int GetDayOfMonth() const { return _day; }
+    int GetDayOfWeek() const { return _weekday; }
+    int GetHour() const { return _hour; }
+    int GetMinute() const { return _minute; }
+    int GetSecond() const { return _second; }
+
+    /**
+    * @brief GetMonthDays - Number of days in the current month.
+    */
+    int GetMonthDays() const { return _month_days; }
+    /**
+    * @brief GetFirstWeekday - Day of week of the 1st of the current month.
+    */
+    int GetFirstWeekday() const { return _first_weekday; }
+
+    /**
+    * @brief SetYear - Jump forward to 00:00:00 of the 1st of January of year.
+    *
+    * @param [year] - Target year, must not be before the current year.
+    *
+    * @returns  Self.
+    */
+    Calendar& SetYear(int year);
+    /**
+    * @brief SetMonth - Jump forward to 00:00:00 of the 1st of month in the current year.
+    *
+    * @param [month] - Target month, must not be before the current month.
+    *
+    * @returns  Self.
+    */
+    Calendar& SetMonth(int month);
+    /**
+    * @brief SetDayOfMonth - Jump forward to 00:00:00 of day in the current month.
+    *
+    * @param [day] - Target day, must be within the current month.
+    *
+    * @returns  Self.
+    */
+    Calendar& SetDayOfMonth(int day);
+    Calendar& SetHour(int hour);
+    Calendar& SetMinute(int minute);
+    Calendar& SetSecond(int second);
+
+    /**
+    * @brief Next* - Advance to the start of the next unit, carrying into upper fields.
+    *
+    * @returns  Self.
+    */
+    Calendar& NextYear();
+    Calendar& NextMonth();
+    Calendar& NextDay();
+    Calendar& NextHour();
+    Calendar& NextMinute();
+    Calendar& NextSecond();
+
+    static bool IsLeapYear(int year) {
+        return ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0);
+    }
+    static int GetMonthDays(int year, int month) {
+        return MonthDaysTable[IsLeapYear(year) ? 1 : 0][month];
+    }
+
+private:
+    static constexpr int MonthDaysTable[2][13] = {
+        {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
+        {0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
+    };
+
+    static int weekday_(long days) {
+        // 1970-01-01 is a Thursday.
+        return (int)(((days % 7) + 7 + 3) % 7) + 1;
+    }
+    void reset_time_();
+
+private:
+    long _days;
+    int _year;
+    int _month;
+    int _day;
+    int _weekday;
+    int _first_weekday;
+    int _month_days;
+    int _hour;
+    int _minute;
+    int _second;
+};
+
+}
+
+#endif
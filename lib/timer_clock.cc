@@ -0,0 +1,153 @@
+#include <cstdlib>
+#include <time.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+#include "timer_log.hh"
+#include "timer_clock.hh"
+
+namespace xg::timer {
+
+namespace {
+
+unsigned long long read_tsc()
+{
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+bool tsc_invariant()
+{
+#if defined(__x86_64__)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return (edx >> 8) & 1;
+    }
+#endif
+    return false;
+}
+
+}
+
+Clock::Clock()
+        : _offset(0), _generation(0), _step_generation(0), _cached(Now().time_since_epoch().count()), _publishers(0),
+          _tsc_invariant(tsc_invariant()), _tsc_base({read_tsc(), Now().time_since_epoch().count(), 0}),
+          _tsc_seq(0), _tsc_tsc(0), _tsc_steady(0), _tsc_scale(0)
+{
+    long long offset = 0;
+    sample_(offset);
+    _offset.store(offset, std::memory_order_relaxed);
+}
+
+bool Clock::sample_(long long& offset)
+{
+    // Bracket the wall read with two steady reads to halve the sampling error.
+    // A wide bracket means the thread was preempted in between.
+    auto narrowest = std::chrono::steady_clock::duration::max();
+    for (int sample = 0; sample < TIMER_CLOCK_SAMPLE_TRIES; ++sample) {
+        auto before = std::chrono::steady_clock::now();
+        auto wall = std::chrono::system_clock::now();
+        auto after = std::chrono::steady_clock::now();
+        if (after - before >= narrowest) {
+            continue;
+        }
+        narrowest = after - before;
+        auto steady = before.time_since_epoch() + (after - before) / 2;
+        offset = std::chrono::duration_cast<std::chrono::nanoseconds>(wall.time_since_epoch() - steady).count();
+    }
+    return narrowest <= TIMER_CLOCK_SAMPLE_BRACKET;
+}
+
+Clock::TimePoint Clock::Coarse()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC_COARSE, &ts)) {
+        return Now();
+    }
+    return TimePoint(std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+}
+
+Clock::TimePoint Clock::Fast() const
+{
+    Calibration calibration;
+    while (true) {
+        unsigned seq = _tsc_seq.load(std::memory_order_acquire);
+        if (!seq) {
+            return Now();
+        }
+        calibration.tsc = _tsc_tsc.load(std::memory_order_relaxed);
+        calibration.steady = _tsc_steady.load(std::memory_order_relaxed);
+        calibration.scale = _tsc_scale.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Retried while a calibration is being published, a few stores long.
+        if (!(seq & 1) && _tsc_seq.load(std::memory_order_relaxed) == seq) {
+            break;
+        }
+    }
+    unsigned __int128 elapsed = (unsigned __int128)(read_tsc() - calibration.tsc) * calibration.scale;
+    return TimePoint(std::chrono::nanoseconds(calibration.steady + (long long)(elapsed >> 32)));
+}
+
+void Clock::Publish(const TimePoint& now)
+{
+    long long value = now.time_since_epoch().count();
+    long long cached = _cached.load(std::memory_order_relaxed);
+    // Several workers publish, keep the latest.
+    while (cached < value && !_cached.compare_exchange_weak(cached, value, std::memory_order_relaxed)) { }
+}
+
+void Clock::calibrate_()
+{
+    if (!_tsc_invariant) {
+        return;
+    }
+    std::scoped_lock lock(_tsc_mutex);
+    Calibration now = {read_tsc(), Now().time_since_epoch().count(), 0};
+    if (now.tsc <= _tsc_base.tsc || now.steady - _tsc_base.steady < std::chrono::nanoseconds(std::chrono::milliseconds(100)).count()) {
+        return;
+    }
+    // Rate from the span since the last calibration, anchored at now so the
+    // error does not accumulate.
+    now.scale = (unsigned long long)(((unsigned __int128)(now.steady - _tsc_base.steady) << 32) / (now.tsc - _tsc_base.tsc));
+    // Single writer under the mutex.
+    unsigned seq = _tsc_seq.load(std::memory_order_relaxed);
+    _tsc_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _tsc_tsc.store(now.tsc, std::memory_order_relaxed);
+    _tsc_steady.store(now.steady, std::memory_order_relaxed);
+    _tsc_scale.store(now.scale, std::memory_order_relaxed);
+    _tsc_seq.store(seq + 2, std::memory_order_release);
+    _tsc_base = now;
+}
+
+bool Clock::Resync()
+{
+    calibrate_();
+    long long offset = 0;
+    if (!sample_(offset)) {
+        return false;
+    }
+    long long old_offset = _offset.load(std::memory_order_relaxed);
+    auto moved = std::chrono::nanoseconds(std::abs(offset - old_offset));
+    if (moved < TIMER_CLOCK_DRIFT_THRESHOLD) {
+        return false;
+    }
+    if (!_offset.compare_exchange_strong(old_offset, offset, std::memory_order_relaxed)) {
+        // Another worker resynced at the same time.
+        return false;
+    }
+    bool stepped = (moved >= TIMER_CLOCK_JUMP_THRESHOLD);
+    if (stepped) {
+        _step_generation.fetch_add(1, std::memory_order_release);
+        TIMER_CLOCK_INFO("Wall clock stepped by [", offset - old_offset, "] ns");
+    }
+    _generation.fetch_add(1, std::memory_order_release);
+    return stepped;
+}
+
+}
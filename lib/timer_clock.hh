@@ -0,0 +1,162 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-16 10:40
+ * @file     : timer_clock.hh
+ * @brief    : Monotonic wheel time base and wall clock mapping.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_CLOCK_HH__
+#define __TIMER_CLOCK_HH__
+
+#include <chrono>
+#include <atomic>
+#include <mutex>
+
+#include "timer_rule.hh"
+
+// Wall clock moves beyond this are handled as a clock step.
+#define TIMER_CLOCK_JUMP_THRESHOLD (std::chrono::milliseconds(100))
+// Smaller moves beyond this only remap wall clock deadlines.
+#define TIMER_CLOCK_DRIFT_THRESHOLD (std::chrono::milliseconds(1))
+// Offset samples with a wider steady bracket were preempted, not used.
+#define TIMER_CLOCK_SAMPLE_BRACKET (std::chrono::microseconds(50))
+// Offset samples per resync, the one with the narrowest bracket is kept.
+#define TIMER_CLOCK_SAMPLE_TRIES (3)
+
+namespace xg::timer {
+
+/**
+* @brief - Wheel time base.
+*          Wheels run on steady_clock, so wall clock steps never move
+*          duration timers. Wall clock rules (crontab) are mapped through a
+*          cached wall - steady offset, re-sampled by Resync. Every offset
+*          change beyond TIMER_CLOCK_DRIFT_THRESHOLD bumps the generation so
+*          workers know to remap their wall clock tasks, a change beyond
+*          TIMER_CLOCK_JUMP_THRESHOLD is a step and also bumps the step
+*          generation, workers then re-arm them.
+*          Besides the precise Now, three cheaper reads are offered for hot
+*          paths: Cached (published by workers once per tick), Fast (TSC)
+*          and Coarse (CLOCK_MONOTONIC_COARSE), all on the same time base.
+*/
+class Clock {
+public:
+    using TimePoint = std::chrono::time_point<std::chrono::steady_clock, std::chrono::nanoseconds>;
+
+public:
+    static Clock& Instance() {
+        static Clock instance;
+        return instance;
+    }
+
+    static TimePoint Now() {
+        return std::chrono::steady_clock::now();
+    }
+
+    /**
+    * @brief Coarse - Kernel tick resolution wheel time, no hardware read.
+    */
+    static TimePoint Coarse();
+
+    /**
+    * @brief Fast - TSC based wheel time, calibrated against Now on Resync.
+    *               Falls back to Now without an invariant TSC or until
+    *               calibrated, so it never lags by more than the
+    *               calibration error.
+    */
+    TimePoint Fast() const;
+
+    /**
+    * @brief Cached - Wheel time published by running workers, at most one
+    *                 tick old. Falls back to Coarse while no worker ticks.
+    */
+    TimePoint Cached() const {
+        if (!_publishers.load(std::memory_order_relaxed)) {
+            return Coarse();
+        }
+        return TimePoint(std::chrono::nanoseconds(_cached.load(std::memory_order_relaxed)));
+    }
+
+    /**
+    * @brief Publish - Publish the time of the current tick, called by workers.
+    */
+    void Publish(const TimePoint& now);
+
+    /**
+    * @brief Attach - A worker starts or stops publishing every tick.
+    */
+    void Attach() { _publishers.fetch_add(1, std::memory_order_relaxed); }
+    void Detach() { _publishers.fetch_sub(1, std::memory_order_relaxed); }
+
+    /**
+    * @brief ToWall - Map a wheel time to wall time with the cached offset.
+    */
+    Rule::RefTimePoint ToWall(const TimePoint& time) const {
+        return Rule::RefTimePoint(time.time_since_epoch() + std::chrono::nanoseconds(_offset.load(std::memory_order_relaxed)));
+    }
+
+    /**
+    * @brief ToSteady - Map a wall time to wheel time with the cached offset.
+    */
+    TimePoint ToSteady(const Rule::RefTimePoint& time) const {
+        return TimePoint(time.time_since_epoch() - std::chrono::nanoseconds(_offset.load(std::memory_order_relaxed)));
+    }
+
+    std::chrono::nanoseconds GetOffset() const {
+        return std::chrono::nanoseconds(_offset.load(std::memory_order_relaxed));
+    }
+
+    unsigned long GetGeneration() const {
+        return _generation.load(std::memory_order_acquire);
+    }
+
+    unsigned long GetStepGeneration() const {
+        return _step_generation.load(std::memory_order_acquire);
+    }
+
+    /**
+    * @brief Resync - Re-sample the wall clock offset.
+    *
+    * @returns  True when the wall clock stepped since the last sample.
+    */
+    bool Resync();
+
+private:
+    Clock();
+    Clock(const Clock&);
+    Clock& operator=(const Clock&);
+
+    static bool sample_(long long& offset);
+    void calibrate_();
+
+private:
+    /**
+    * @brief - TSC to wheel time, ns = steady + ((tsc - base) * scale >> 32).
+    */
+    struct Calibration {
+        unsigned long long tsc;
+        long long steady;
+        unsigned long long scale;
+    };
+
+    std::atomic<long long> _offset;
+    std::atomic<unsigned long> _generation;
+    std::atomic<unsigned long> _step_generation;
+    std::atomic<long long> _cached;
+    std::atomic<int> _publishers;
+
+    bool _tsc_invariant;
+    std::mutex _tsc_mutex;
+    Calibration _tsc_base;          // last calibration, under _tsc_mutex
+    // Calibration read by Fast. Seqlock, odd while written, 0 until calibrated.
+    std::atomic<unsigned> _tsc_seq;
+    std::atomic<unsigned long long> _tsc_tsc;
+    std::atomic<long long> _tsc_steady;
+    std::atomic<unsigned long long> _tsc_scale;
+};
+
+}
+
+#endif
@@ -0,0 +1,165 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-24 09:30
+ * @file     : timer_function.hh
+ * @brief    : Move only callable with inline storage.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_FUNCTION_HH__
+#define __TIMER_FUNCTION_HH__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <functional>
+
+// Inline storage, a lambda capturing up to six pointers fits.
+#define TIMER_FUNCTION_INLINE_SIZE (48)
+
+namespace xg::timer {
+
+template<typename Signature, size_t Capacity = TIMER_FUNCTION_INLINE_SIZE>
+class UniqueFunction;
+
+/**
+* @brief - Move only replacement of std::function.
+*          Callables up to Capacity bytes with a nothrow move are stored in
+*          place, larger ones on the heap. Being move only, it also accepts
+*          callables capturing move only state (unique_ptr, promise).
+*/
+template<typename R, typename... Args, size_t Capacity>
+class UniqueFunction<R(Args...), Capacity> {
+public:
+    UniqueFunction() noexcept : _ops(nullptr) { }
+    UniqueFunction(std::nullptr_t) noexcept : _ops(nullptr) { }
+
+    template<typename F, typename Fn = std::decay_t<F>,
+             typename = std::enable_if_t<!std::is_same_v<Fn, UniqueFunction> && std::is_invocable_r_v<R, Fn&, Args...>>>
+    UniqueFunction(F&& callable) : _ops(nullptr) {
+        if constexpr (std::is_pointer_v<Fn> || std::is_member_pointer_v<Fn>) {
+            if (!callable) {
+                return;
+            }
+        }
+        if constexpr (Inline<Fn>) {
+            ::new ((void*)_storage) Fn(std::forward<F>(callable));
+        } else {
+            ::new ((void*)_storage) Fn*(new Fn(std::forward<F>(callable)));
+        }
+        _ops = &OPS<Fn>;
+    }
+
+    UniqueFunction(UniqueFunction&& other) noexcept : _ops(other._ops) {
+        if (_ops) {
+            _ops->move(_storage, other._storage);
+            other._ops = nullptr;
+        }
+    }
+
+    UniqueFunction& operator=(UniqueFunction&& other) noexcept {
+        if (this != &other) {
+            reset_();
+            if (other._ops) {
+                other._ops->move(_storage, other._storage);
+                _ops = other._ops;
+                other._ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    UniqueFunction& operator=(std::nullptr_t) noexcept {
+        reset_();
+        return *this;
+    }
+
+    UniqueFunction(const UniqueFunction&) = delete;
+    UniqueFunction& operator=(const UniqueFunction&) = delete;
+
+    ~UniqueFunction() {
+        reset_();
+    }
+
+    explicit operator bool() const noexcept {
+        return _ops != nullptr;
+    }
+
+    /**
+    * @brief IsInline - Whether a callable type is stored without allocation.
+    */
+    template<typename F>
+    static constexpr bool IsInline() {
+        return Inline<std::decay_t<F>>;
+    }
+
+    R operator()(Args... args) {
+        return _ops->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+private:
+    struct Ops {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template<typename Fn>
+    static constexpr bool Inline = sizeof(Fn) <= Capacity && alignof(Fn) <= alignof(std::max_align_t)
+                                   && std::is_nothrow_move_constructible_v<Fn>;
+
+    template<typename Fn>
+    static Fn* target_(void* storage) noexcept {
+        if constexpr (Inline<Fn>) {
+            return std::launder(reinterpret_cast<Fn*>(storage));
+        } else {
+            return *std::launder(reinterpret_cast<Fn**>(storage));
+        }
+    }
+
+    template<typename Fn>
+    static R invoke_(void* storage, Args&&... args) {
+        return std::invoke(*target_<Fn>(storage), std::forward<Args>(args)...);
+    }
+
+    template<typename Fn>
+    static void move_(void* dst, void* src) noexcept {
+        if constexpr (Inline<Fn>) {
+            Fn* from = target_<Fn>(src);
+            ::new (dst) Fn(std::move(*from));
+            from->~Fn();
+        } else {
+            ::new (dst) Fn*(target_<Fn>(src));
+        }
+    }
+
+    template<typename Fn>
+    static void destroy_(void* storage) noexcept {
+        if constexpr (Inline<Fn>) {
+            target_<Fn>(storage)->~Fn();
+        } else {
+            delete target_<Fn>(storage);
+        }
+    }
+
+    template<typename Fn>
+    static constexpr Ops OPS = { &invoke_<Fn>, &move_<Fn>, &destroy_<Fn> };
+
+    void reset_() noexcept {
+        if (_ops) {
+            _ops->destroy(_storage);
+            _ops = nullptr;
+        }
+    }
+
+private:
+    alignas(std::max_align_t) unsigned char _storage[Capacity];
+    const Ops* _ops;
+};
+
+}
+
+#endif
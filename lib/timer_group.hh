@@ -0,0 +1,57 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-25 09:40
+ * @file     : timer_group.hh
+ * @brief    : Group of tasks cancelled or moved as one.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_GROUP_HH__
+#define __TIMER_GROUP_HH__
+
+#include <atomic>
+
+namespace xg::timer {
+
+class Task;
+class WheelWorker;
+
+/**
+* @brief - Timer group, e.g. all timers of one connection.
+*          Members of a group live on the group's worker and are linked into
+*          an intrusive list through the tasks, so cancelling or moving the
+*          group is one command touching its members only, no wheel scan.
+*          A cancelled group is closed, later Schedule calls on it fail.
+*/
+class TimerGroup {
+public:
+    TimerGroup(WheelWorker& worker) : _worker(worker), _cancelled(false), _head(nullptr), _size(0) { }
+    TimerGroup(const TimerGroup&) = delete;
+    TimerGroup& operator=(const TimerGroup&) = delete;
+
+    bool Cancelled() const {
+        return _cancelled.load(std::memory_order_acquire);
+    }
+
+    /**
+    * @brief Size - Scheduled members, updated by the worker thread.
+    */
+    size_t Size() const {
+        return _size.load(std::memory_order_relaxed);
+    }
+
+private:
+    friend class WheelWorker;
+    friend class WheelManager;
+
+    WheelWorker& _worker;
+    std::atomic<bool> _cancelled;
+    Task* _head;                // worker thread only
+    std::atomic<size_t> _size;
+};
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include <fstream>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "timer_log.hh"
+#include "timer_numa.hh"
+
+namespace xg::timer {
+
+Numa::Numa()
+{
+    for (int node = 0; ; ++node) {
+        std::ifstream file(std::string(TIMER_NUMA_NODE_DIR) + "/node" + std::to_string(node) + "/cpulist");
+        if (!file) {
+            break;
+        }
+        std::string list;
+        std::getline(file, list);
+        _nodes.push_back(ParseCpuList(list));
+    }
+    if (_nodes.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < (int)std::thread::hardware_concurrency(); ++cpu) {
+            cpus.push_back(cpu);
+        }
+        _nodes.push_back(cpus);
+    }
+    TIMER_OS_INFO("Numa nodes[", _nodes.size(), "]");
+}
+
+int Numa::GetNodes() const
+{
+    return (int)_nodes.size();
+}
+
+const std::vector<int>& Numa::GetCpus(int node) const
+{
+    static const std::vector<int> empty;
+    if (node < 0 || node >= (int)_nodes.size()) {
+        return empty;
+    }
+    return _nodes[node];
+}
+
+int Numa::GetNode(int cpu) const
+{
+    for (size_t node = 0; node < _nodes.size(); ++node) {
+        for (int id : _nodes[node]) {
+            if (id == cpu) {
+                return (int)node;
+            }
+        }
+    }
+    return 0;
+}
+
+Return Numa::Prefer(void* addr, size_t size, int node) const
+{
+    if (_nodes.size() < 2 || node < 0 || node >= (int)_nodes.size()) {
+        return Return::SUCCESS;
+    }
+    unsigned long mask[TIMER_NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = { 0 };
+    if (node >= TIMER_NUMA_MAX_NODES) {
+        return Return::ERROR;
+    }
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    // mbind through syscall, no libnuma dependency.
+    if (syscall(SYS_mbind, addr, size, TIMER_NUMA_MPOL_PREFERRED, mask, TIMER_NUMA_MAX_NODES + 1, 0)) {
+        return errno;
+    }
+    return Return::SUCCESS;
+}
+
+Return Numa::SetAffinity(const std::vector<int>& cpus)
+{
+    if (cpus.empty()) {
+        return Return::SUCCESS;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (ret) {
+        return ret;
+    }
+    return Return::SUCCESS;
+}
+
+std::vector<int> Numa::ParseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string range = list.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (...) { }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+}
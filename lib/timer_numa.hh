@@ -0,0 +1,97 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-20 10:30
+ * @file     : timer_numa.hh
+ * @brief    : NUMA topology and thread placement.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_NUMA_HH__
+#define __TIMER_NUMA_HH__
+
+#include <vector>
+#include <string>
+
+#include "timer_return.hh"
+
+#define TIMER_NUMA_NODE_DIR "/sys/devices/system/node"
+#define TIMER_NUMA_MAX_NODES (1024)
+// MPOL_PREFERRED of linux/mempolicy.h.
+#define TIMER_NUMA_MPOL_PREFERRED (1)
+
+namespace xg::timer {
+
+/**
+* @brief - NUMA topology read once from sysfs.
+*          Memory placement relies on first touch: a worker pins itself to
+*          the cpus of its node before allocating and touching its wheel and
+*          queues, so the kernel backs them with node local pages. Hosts
+*          without NUMA show up as a single node holding every cpu.
+*/
+class Numa {
+public:
+    static Numa& Instance() {
+        static Numa instance;
+        return instance;
+    }
+
+    int GetNodes() const;
+
+    /**
+    * @brief GetCpus - Online cpus of a node.
+    *
+    * @param [node] - Node index, 0 .. GetNodes() - 1.
+    *
+    * @returns  Cpu ids, empty for an unknown node.
+    */
+    const std::vector<int>& GetCpus(int node) const;
+
+    /**
+    * @brief GetNode - Node of a cpu.
+    *
+    * @param [cpu] - Cpu id.
+    *
+    * @returns  Node index, 0 for an unknown cpu.
+    */
+    int GetNode(int cpu) const;
+
+    /**
+    * @brief Prefer - Ask the kernel to back a not yet touched mapping with
+    *                 pages of a node, whichever thread touches it first.
+    *
+    * @param [addr] - Page aligned start of the mapping.
+    * @param [size] - Mapping size.
+    * @param [node] - Node index.
+    *
+    * @returns  Return class.
+    */
+    Return Prefer(void* addr, size_t size, int node) const;
+
+    /**
+    * @brief SetAffinity - Pin the calling thread.
+    *
+    * @param [cpus] - Cpu ids, empty leaves the thread unpinned.
+    *
+    * @returns  Return class.
+    */
+    static Return SetAffinity(const std::vector<int>& cpus);
+
+    /**
+    * @brief ParseCpuList - Parse a sysfs cpu list, e.g. "0-3,8-11".
+    */
+    static std::vector<int> ParseCpuList(const std::string& list);
+
+private:
+    Numa();
+    Numa(const Numa&);
+    Numa& operator=(const Numa&);
+
+private:
+    std::vector<std::vector<int>> _nodes;
+};
+
+}
+
+#endif
@@ -19,6 +19,9 @@ namespace xg::timer {
 
 /**
 * @brief - d task scheduling rule base class.
+*          Rules are immutable once constructed, evaluation is const and
+*          may run on several threads at once. State of one use, such as
+*          the last fire time, is kept by the caller (the Task).
 */
 class Rule {
 public:
@@ -37,7 +40,7 @@ public:
     *
     * @returns Bool 
     */
-    virtual bool Valid(WheelAccuracy& accuracy) = 0;
+    virtual bool Valid(WheelAccuracy& accuracy) const = 0;
 
     /**
     * @brief GetNextExprieScale - Based on the given time and accuracy,
@@ -48,7 +51,7 @@ public:
     *
     * @returns  Tuple of Return class & WheelScale.
     */
-    virtual std::tuple<Return, WheelScale> GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy) = 0;
+    virtual std::tuple<Return, WheelScale> GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy) const = 0;
 
     /**
     * @brief GetNextExprieTime - Based on the given time,
@@ -58,7 +61,16 @@ public:
     *
     * @returns Next time. 
     */
-    virtual std::tuple<Return, RefTimePoint> GetNextExprieTime(RefTimePoint&& reftime) = 0;
+    virtual std::tuple<Return, RefTimePoint> GetNextExprieTime(RefTimePoint&& reftime) const = 0;
+
+    /**
+    * @brief IsWallClock - Whether fire times follow the wall clock.
+    *                      Such tasks are re-armed when the wall clock steps,
+    *                      others only depend on elapsed time.
+    *
+    * @returns Bool
+    */
+    virtual bool IsWallClock() const { return false; }
 };
 
 }
@@ -1,79 +1,156 @@
 #include <regex>
 #include <algorithm>
+#include <bit>
+#include <charconv>
+#include <climits>
 
 #include "timer_log.hh"
+#include "timer_clock.hh"
 #include "timer_rule_crontab.hh"
+#include "timer_rule_crontab_literal.hh"
 
 namespace xg::timer {
 
 //Field
-std::map<RuleCrontab::FieldRule::RuleType, std::regex>
+const std::map<RuleCrontab::FieldRule::RuleType, std::regex>
 RuleCrontab::FieldRule::RegexTable = {
-    {RuleCrontab::FieldRule::RuleType::SyntaxCheck, std::regex("([0-9]|[\\/]|[\\*]|[\\-]|[\\,])*")},
+    {RuleCrontab::FieldRule::RuleType::SyntaxCheck, std::regex("([0-9]|[\\/]|[\\*]|[\\-]|[\\,]|[\\?]|[LW#])*")},
     {RuleCrontab::FieldRule::RuleType::Any, std::regex("(\\*)")},
     {RuleCrontab::FieldRule::RuleType::Frequency, std::regex("\\*[\\/]([0-9]+)")},
     {RuleCrontab::FieldRule::RuleType::Range, std::regex("[0-9]+\\-[0-9]+")},
     {RuleCrontab::FieldRule::RuleType::FrequencyRange, std::regex("[0-9]+\\-[0-9]+[\\/]([0-9]+)")},
     {RuleCrontab::FieldRule::RuleType::Value, std::regex("[0-9]+")},
+    {RuleCrontab::FieldRule::RuleType::FrequencyValue, std::regex("[0-9]+[\\/]([0-9]+)")},
+    {RuleCrontab::FieldRule::RuleType::NoSpecific, std::regex("(\\?)")},
+    {RuleCrontab::FieldRule::RuleType::LastDay, std::regex("L(\\-[0-9]+)?")},
+    {RuleCrontab::FieldRule::RuleType::NearestWeekday, std::regex("[0-9]+W")},
+    {RuleCrontab::FieldRule::RuleType::LastWeekday, std::regex("LW")},
+    {RuleCrontab::FieldRule::RuleType::NthDayOfWeek, std::regex("[0-9]+#[0-9]+")},
+    {RuleCrontab::FieldRule::RuleType::LastDayOfWeek, std::regex("[0-9]+L")},
 };
 
-RuleCrontab::FieldRule::FieldRule(std::string rule, int max, int min)
-        : _parsed(false), _raw_rule(rule), _field_max_value(max), _field_min_value(min)
+// Number extractors of the sub rules, compiled once instead of per rule.
+const std::map<RuleCrontab::FieldRule::RuleType, std::regex>
+RuleCrontab::FieldRule::ValueRegexTable = {
+    {RuleCrontab::FieldRule::RuleType::Frequency, std::regex("([0-9]+)")},
+    {RuleCrontab::FieldRule::RuleType::Range, std::regex("([0-9]+)\\-([0-9]+)")},
+    {RuleCrontab::FieldRule::RuleType::FrequencyRange, std::regex("([0-9]+)\\-([0-9]+)\\/([0-9]+)")},
+    {RuleCrontab::FieldRule::RuleType::FrequencyValue, std::regex("([0-9]+)\\/([0-9]+)")},
+    {RuleCrontab::FieldRule::RuleType::NthDayOfWeek, std::regex("([0-9]+)#([0-9]+)")},
+};
+
+RuleCrontab::FieldRule::FieldRule(std::string rule, int max, int min, std::set<RuleType> extends)
+        : _parsed(false), _raw_rule(rule), _field_max_value(max), _field_min_value(min),
+          _extend_types(extends), _last_mask(0), _nearest_mask(0), _nth_mask(0), _last_weekday(false), _any(false)
 {
     ParseRule();
     ValidRule();
+    CompileRule();
+}
+RuleCrontab::FieldRule::FieldRule(const CrontabField& field, int max, int min)
+        : _parsed(true), _field_max_value(max), _field_min_value(min),
+          _mask(field.mask, field.mask + max / 64 + 1), _last_mask(field.last_mask), _nearest_mask(field.nearest_mask),
+          _nth_mask(field.nth_mask), _last_weekday(field.last_weekday), _any(field.any)
+{
 }
 RuleCrontab::FieldRule::FieldRule(RuleCrontab::FieldRule&& other)
 {
     _parsed = other._parsed;
     _raw_rule = other._raw_rule;
-    _last_time = other._last_time;
     _rule_map = other._rule_map;
+    _extend_types = other._extend_types;
+    _mask = other._mask;
+    _last_mask = other._last_mask;
+    _nearest_mask = other._nearest_mask;
+    _nth_mask = other._nth_mask;
+    _last_weekday = other._last_weekday;
+    _any = other._any;
     _field_max_value = other._field_max_value;
     _field_min_value = other._field_min_value;
 }
 
-bool RuleCrontab::FieldRule::Valid()
+bool RuleCrontab::FieldRule::Valid() const
 {
     return _parsed;
 }
 
+bool RuleCrontab::FieldRule::IsAny() const
+{
+    return _any;
+}
+
+bool RuleCrontab::FieldRule::HasSpecial() const
+{
+    return (_last_mask || _nearest_mask || _nth_mask || _last_weekday);
+}
+
+int RuleCrontab::FieldRule::to_int_(const std::string& text)
+{
+    int value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc()) {
+        return INT_MAX;
+    }
+    return value;
+}
+
+std::string RuleCrontab::FieldRule::replace_names_(std::string rule, const std::vector<std::string>& names, int first)
+{
+    std::transform(rule.begin(), rule.end(), rule.begin(), [](unsigned char c) { return std::toupper(c); });
+    for (size_t index = 0; index < names.size(); ++index) {
+        size_t pos;
+        while ((pos = rule.find(names[index])) != std::string::npos) {
+            rule.replace(pos, names[index].size(), std::to_string(first + (int)index));
+        }
+    }
+    return rule;
+}
+
 void RuleCrontab::FieldRule::Print()
 {
 }
 
 void RuleCrontab::FieldRule::ParseRule()
 {
-    if (!std::regex_match(_raw_rule, RegexTable[RuleType::SyntaxCheck])) {
+    if (!std::regex_match(_raw_rule, RegexTable.at(RuleType::SyntaxCheck))) {
         TIMER_RULE_ERROR("Parse Month rule[", _raw_rule, "] syntax error");
         _parsed = false;
         return;
     }
 
-    std::regex word_regex("[^,]+");
+    static const std::regex word_regex("[^,]+");
     auto words_begin = std::sregex_iterator(_raw_rule.begin(), _raw_rule.end(), word_regex);
     auto words_end = std::sregex_iterator();
     for (std::sregex_iterator i = words_begin; i != words_end; ++i) {
         std::smatch match = *i;
         std::string sub_rule = match.str();
         TIMER_RULE_INFO("sub rule[", sub_rule, "]");
-        if (std::regex_match(sub_rule, RegexTable[RuleType::Any])) {
+        if (std::regex_match(sub_rule, RegexTable.at(RuleType::Any))) {
             _rule_map.insert({RuleType::Any, sub_rule});
-        } else if (std::regex_match(sub_rule, RegexTable[RuleType::Frequency])) {
+        } else if (std::regex_match(sub_rule, RegexTable.at(RuleType::Frequency))) {
             _rule_map.insert({RuleType::Frequency, sub_rule});
-        } else if (std::regex_match(sub_rule, RegexTable[RuleType::Range])) {
+        } else if (std::regex_match(sub_rule, RegexTable.at(RuleType::Range))) {
             _rule_map.insert({RuleType::Range, sub_rule});
-        } else if (std::regex_match(sub_rule, RegexTable[RuleType::FrequencyRange])) {
+        } else if (std::regex_match(sub_rule, RegexTable.at(RuleType::FrequencyRange))) {
             _rule_map.insert({RuleType::FrequencyRange, sub_rule});
-        } else if (std::regex_match(sub_rule, RegexTable[RuleType::Value])) {
+        } else if (std::regex_match(sub_rule, RegexTable.at(RuleType::Value))) {
             _rule_map.insert({RuleType::Value, sub_rule});
+        } else if (std::regex_match(sub_rule, RegexTable.at(RuleType::FrequencyValue))) {
+            _rule_map.insert({RuleType::FrequencyValue, sub_rule});
         } else {
-            TIMER_RULE_ERROR("Parse Month rule[", _raw_rule, "] syntax error");
-            _parsed = false;
-            return;
+            auto type_it = std::find_if(_extend_types.begin(), _extend_types.end(),
+                    [&](RuleType type) { return std::regex_match(sub_rule, RegexTable.at(type)); });
+            if (type_it == _extend_types.end()) {
+                TIMER_RULE_ERROR("Parse Month rule[", _raw_rule, "] syntax error");
+                _parsed = false;
+                return;
+            }
+            _rule_map.insert({*type_it, sub_rule});
         }
     }
 
+    _any = (_rule_map.find(RuleType::Any) != _rule_map.end()
+            || _rule_map.find(RuleType::NoSpecific) != _rule_map.end());
     _parsed = true;
 }
 
@@ -85,20 +162,23 @@ void RuleCrontab::FieldRule::ValidRule()
             case RuleType::Frequency:
             {
                 std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)"))) {
+                if (!std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::Frequency))) {
                     TIMER_RULE_ERROR("Not found frequency in rule[" , rule.second, "]");
                     _parsed = false;
                 }
                 if (sm.size() != 2) {
                     TIMER_RULE_ERROR("Not found right frequency in rule[" , rule.second, "]");
                     _parsed = false;
+                } else if (to_int_(sm.str(1)) == 0) {
+                    TIMER_RULE_ERROR("Frequency is zero in rule[" , rule.second, "]");
+                    _parsed = false;
                 }
             }
             break;
             case RuleType::Range:
             {
                 std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)"))) {
+                if (!std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::Range))) {
                     TIMER_RULE_ERROR("Not found range in rule[" , rule.second, "]");
                     _parsed = false;
                 }
@@ -106,16 +186,16 @@ void RuleCrontab::FieldRule::ValidRule()
                     TIMER_RULE_ERROR("Not found right range in rule[" , rule.second, "]");
                     _parsed = false;
                 }
-                if (std::stoi(sm.str(1)) >= std::stoi(sm.str(2))) {
+                if (to_int_(sm.str(1)) >= to_int_(sm.str(2))) {
                     TIMER_RULE_ERROR("Range start >= end in rule[" , rule.second, "]");
                     _parsed = false;
                 }
-                if (std::stoi(sm.str(1)) < _field_min_value || std::stoi(sm.str(1)) > _field_max_value) {
-                    TIMER_RULE_ERROR("Range start value [", std::stoi(sm.str(1)), "] invalid in rule[" , rule.second, "]");
+                if (to_int_(sm.str(1)) < _field_min_value || to_int_(sm.str(1)) > _field_max_value) {
+                    TIMER_RULE_ERROR("Range start value [", to_int_(sm.str(1)), "] invalid in rule[" , rule.second, "]");
                     _parsed = false;
                 }
-                if (std::stoi(sm.str(2)) < _field_min_value || std::stoi(sm.str(2)) > _field_max_value) {
-                    TIMER_RULE_ERROR("Range end value [", std::stoi(sm.str(2)), "] invalid in rule[" , rule.second, "]");
+                if (to_int_(sm.str(2)) < _field_min_value || to_int_(sm.str(2)) > _field_max_value) {
+                    TIMER_RULE_ERROR("Range end value [", to_int_(sm.str(2)), "] invalid in rule[" , rule.second, "]");
                     _parsed = false;
                 }
             }
@@ -123,7 +203,7 @@ void RuleCrontab::FieldRule::ValidRule()
             case RuleType::FrequencyRange:
             {
                 std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)\\/([0-9]+)"))) {
+                if (!std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::FrequencyRange))) {
                     TIMER_RULE_ERROR("Not found frequency & range in rule[" , rule.second, "]");
                     _parsed = false;
                 }
@@ -131,188 +211,197 @@ void RuleCrontab::FieldRule::ValidRule()
                     TIMER_RULE_ERROR("Not found right frequency & range in rule[" , rule.second, "]");
                     _parsed = false;
                 }
-                if (std::stoi(sm.str(1)) >= std::stoi(sm.str(2))) {
+                if (to_int_(sm.str(1)) >= to_int_(sm.str(2))) {
                     TIMER_RULE_ERROR("Range start >= end in rule[" , rule.second, "]");
                     _parsed = false;
                 }
-                if (std::stoi(sm.str(1)) < _field_min_value || std::stoi(sm.str(1)) > _field_max_value) {
-                    TIMER_RULE_ERROR("Range start value [", std::stoi(sm.str(1)), "] invalid in rule[" , rule.second, "]");
+                if (to_int_(sm.str(1)) < _field_min_value || to_int_(sm.str(1)) > _field_max_value) {
+                    TIMER_RULE_ERROR("Range start value [", to_int_(sm.str(1)), "] invalid in rule[" , rule.second, "]");
+                    _parsed = false;
+                }
+                if (to_int_(sm.str(2)) < _field_min_value || to_int_(sm.str(2)) > _field_max_value) {
+                    TIMER_RULE_ERROR("Range end value [", to_int_(sm.str(2)), "] invalid in rule[" , rule.second, "]");
                     _parsed = false;
                 }
-                if (std::stoi(sm.str(2)) < _field_min_value || std::stoi(sm.str(2)) > _field_max_value) {
-                    TIMER_RULE_ERROR("Range end value [", std::stoi(sm.str(2)), "] invalid in rule[" , rule.second, "]");
+                if (to_int_(sm.str(3)) == 0) {
+                    TIMER_RULE_ERROR("Frequency is zero in rule[" , rule.second, "]");
                     _parsed = false;
                 }
-                if (std::stoi(sm.str(3)) > (std::stoi(sm.str(2)) - std::stoi(sm.str(1)))) {
+                if (to_int_(sm.str(3)) > (to_int_(sm.str(2)) - to_int_(sm.str(1)))) {
                     TIMER_RULE_ERROR("Range value < frequency value in rule[" , rule.second, "]");
                     _parsed = false;
                 }
             }
             break;
             case RuleType::Value:
-                if (std::stoi(rule.second) < _field_min_value || std::stoi(rule.second) > _field_max_value) {
+                if (to_int_(rule.second) < _field_min_value || to_int_(rule.second) > _field_max_value) {
                     TIMER_RULE_ERROR("Value invalid in rule[" , rule.second, "]");
                     _parsed = false;
                 }
                 break;
-            default:
-                break;
-        }
-    }
-}
-
-void RuleCrontab::FieldRule::SetLastTime(Rule::RefTimePoint&& last_time)
-{
-    _last_time = last_time;
-}
-
-bool RuleCrontab::FieldRule::CheckValue(int curr_value)
-{
-    if (!_parsed) return false;
-    for (auto rule : _rule_map) {
-        switch (rule.first) {
-            case RuleType::Any:
-                return true;
-            case RuleType::Frequency:
-                return true;
-            case RuleType::Range:
+            case RuleType::FrequencyValue:
             {
                 std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found range in rule[" , rule.second, "]");
+                std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::FrequencyValue));
+                if (to_int_(sm.str(1)) < _field_min_value || to_int_(sm.str(1)) > _field_max_value) {
+                    TIMER_RULE_ERROR("Value invalid in rule[" , rule.second, "]");
                     _parsed = false;
-                    return false;
                 }
-                if (sm.size() != 3) {
-                    TIMER_RULE_ERROR("Not found right range in rule[" , rule.second, "]");
+                if (to_int_(sm.str(2)) == 0) {
+                    TIMER_RULE_ERROR("Frequency is zero in rule[" , rule.second, "]");
                     _parsed = false;
-                    return false;
                 }
-                if (curr_value >= std::stoi(sm.str(1)) || curr_value <= std::stoi(sm.str(2))) {
-                    return true;
+                if (to_int_(sm.str(2)) > _field_max_value - to_int_(sm.str(1))) {
+                    TIMER_RULE_ERROR("Frequency beyond the field in rule[" , rule.second, "]");
+                    _parsed = false;
                 }
             }
             break;
-            case RuleType::FrequencyRange:
+            case RuleType::LastDay:
+                if (rule.second.size() > 2 && to_int_(rule.second.substr(2)) >= TIMER_MAX_DAYOFMONTH) {
+                    TIMER_RULE_ERROR("Last day offset invalid in rule[" , rule.second, "]");
+                    _parsed = false;
+                }
+                break;
+            case RuleType::NearestWeekday:
+                if (to_int_(rule.second) < TIMER_MIN_DAYOFMONTH || to_int_(rule.second) > TIMER_MAX_DAYOFMONTH) {
+                    TIMER_RULE_ERROR("Value invalid in rule[" , rule.second, "]");
+                    _parsed = false;
+                }
+                break;
+            case RuleType::NthDayOfWeek:
             {
                 std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)\\/([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found frequency & range in rule[" , rule.second, "]");
+                std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::NthDayOfWeek));
+                if (to_int_(sm.str(1)) < TIMER_MIN_DAYOFWEEK || to_int_(sm.str(1)) > TIMER_MAX_DAYOFWEEK) {
+                    TIMER_RULE_ERROR("Value invalid in rule[" , rule.second, "]");
                     _parsed = false;
-                    return false;
                 }
-                if (sm.size() != 4) {
-                    TIMER_RULE_ERROR("Not found right frequency & range in rule[" , rule.second, "]");
+                if (to_int_(sm.str(2)) < 1 || to_int_(sm.str(2)) > 5) {
+                    TIMER_RULE_ERROR("Week index invalid in rule[" , rule.second, "]");
                     _parsed = false;
-                    return false;
-                }
-                if (curr_value >= std::stoi(sm.str(1)) || curr_value <= std::stoi(sm.str(2))) {
-                    return true;
                 }
             }
             break;
-            case RuleType::Value:
-                if (curr_value == std::stoi(rule.second)) {
-                    return true;
+            case RuleType::LastDayOfWeek:
+                if (to_int_(rule.second) < TIMER_MIN_DAYOFWEEK || to_int_(rule.second) > TIMER_MAX_DAYOFWEEK) {
+                    TIMER_RULE_ERROR("Value invalid in rule[" , rule.second, "]");
+                    _parsed = false;
                 }
                 break;
             default:
-                return false;
+                break;
         }
     }
-    return false;
 }
 
-std::tuple<Return, int> RuleCrontab::FieldRule::GetNextValue(int curr_value)
+void RuleCrontab::FieldRule::CompileRule()
 {
-    if (!_parsed) return {Return::ESCHEDULE_RULE_INVALID, -1};
-    int next_value_min = -1;
+    _mask.assign(_field_max_value / 64 + 1, 0);
+    if (!_parsed) return;
     for (auto rule : _rule_map) {
-        int next_value_tmp = -1;
+        int begin = _field_min_value;
+        int end = _field_max_value;
+        int step = 1;
+        std::smatch sm;
         switch (rule.first) {
             case RuleType::Any:
-                next_value_tmp = curr_value + 1;
                 break;
             case RuleType::Frequency:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found frequency in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 2) {
-                    TIMER_RULE_ERROR("Not found right frequency in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                next_value_tmp = curr_value + std::stoi(sm.str(1));
-            }
-            break;
+                std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::Frequency));
+                step = to_int_(sm.str(1));
+                break;
             case RuleType::Range:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 3) {
-                    TIMER_RULE_ERROR("Not found right range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (curr_value < std::stoi(sm.str(1))) {
-                    next_value_tmp = std::stoi(sm.str(1));
-                } else if (curr_value >= std::stoi(sm.str(2))) {
-                    next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(sm.str(1));
-                } else {
-                    next_value_tmp = curr_value + 1;
-                }
-            }
-            break;
+                std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::Range));
+                begin = to_int_(sm.str(1));
+                end = to_int_(sm.str(2));
+                break;
             case RuleType::FrequencyRange:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)\\/([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found frequency & range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 4) {
-                    TIMER_RULE_ERROR("Not found right frequency & range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (curr_value < std::stoi(sm.str(1))) {
-                    next_value_tmp = std::stoi(sm.str(1));
-                } else if (curr_value >= std::stoi(sm.str(2))) {
-                    next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(sm.str(1));
-                } else {
-                    next_value_tmp = curr_value + std::stoi(sm.str(3));
-                    if (next_value_tmp > std::stoi(sm.str(2))) {
-                        next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(sm.str(1));
-                    }
-                }
-            }
-            break;
+                std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::FrequencyRange));
+                begin = to_int_(sm.str(1));
+                end = to_int_(sm.str(2));
+                step = to_int_(sm.str(3));
+                break;
             case RuleType::Value:
-                if (curr_value < std::stoi(rule.second)) {
-                    next_value_tmp = std::stoi(rule.second);
-                } else {
-                    next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(rule.second);
-                }
+                begin = to_int_(rule.second);
+                end = begin;
                 break;
+            case RuleType::FrequencyValue:
+                std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::FrequencyValue));
+                begin = to_int_(sm.str(1));
+                step = to_int_(sm.str(2));
+                break;
+            case RuleType::NoSpecific:
+                break;
+            // Month dependent values, resolved by RuleCrontab::GetDayMask.
+            case RuleType::LastDay:
+                _last_mask |= (1ULL << (rule.second.size() > 2 ? to_int_(rule.second.substr(2)) : 0));
+                continue;
+            case RuleType::NearestWeekday:
+                _nearest_mask |= (1ULL << to_int_(rule.second));
+                continue;
+            case RuleType::LastWeekday:
+                _last_weekday = true;
+                continue;
+            case RuleType::NthDayOfWeek:
+                std::regex_search(rule.second, sm, ValueRegexTable.at(RuleType::NthDayOfWeek));
+                _nth_mask |= (1ULL << ((to_int_(sm.str(1)) - 1) * 8 + to_int_(sm.str(2))));
+                continue;
+            case RuleType::LastDayOfWeek:
+                _last_mask |= (1ULL << to_int_(rule.second));
+                continue;
             default:
-                return {Return::ESCHEDULE_RULE_INVALID, -1};
+                continue;
         }
-        if (next_value_min == -1) {
-            next_value_min = next_value_tmp;
-        } else {
-            next_value_min = next_value_tmp < next_value_min ? next_value_tmp : next_value_min;
+        // Stops before value + step could overflow.
+        for (int value = begin; value <= end; value += step) {
+            _mask[value >> 6] |= (1ULL << (value & 63));
+            if (end - value < step) {
+                break;
+            }
         }
     }
-    return {Return::SUCCESS, next_value_min};
+}
+
+const std::vector<uint64_t>& RuleCrontab::FieldRule::GetMask() const
+{
+    return _mask;
+}
+
+int RuleCrontab::FieldRule::find_next_(int value) const
+{
+    if (value < 0) value = 0;
+    for (size_t index = value >> 6; index < _mask.size(); ++index) {
+        uint64_t bits = _mask[index];
+        if (index == (size_t)(value >> 6)) {
+            bits &= (~0ULL << (value & 63));
+        }
+        if (bits) {
+            return (int)(index * 64) + std::countr_zero(bits);
+        }
+    }
+    return -1;
+}
+
+bool RuleCrontab::FieldRule::CheckValue(int curr_value) const
+{
+    if (!_parsed || curr_value < 0 || curr_value > _field_max_value) return false;
+    return ((_mask[curr_value >> 6] >> (curr_value & 63)) & 1);
+}
+
+std::tuple<Return, int> RuleCrontab::FieldRule::GetNextValue(int curr_value) const
+{
+    if (!_parsed) return {Return::ESCHEDULE_RULE_INVALID, -1};
+    int next_value = find_next_(curr_value + 1);
+    if (next_value != -1) {
+        return {Return::SUCCESS, next_value};
+    }
+    // Wrapped into the next cycle of the upper field.
+    next_value = find_next_(_field_min_value);
+    if (next_value == -1) {
+        return {Return::ESCHEDULE_RULE_INVALID, -1};
+    }
+    return {Return::SUCCESS, _field_max_value - _field_min_value + 1 + next_value};
 }
 
 //RuleCrontab::YearRule
@@ -320,116 +409,32 @@ RuleCrontab::YearRule::YearRule(std::string rule)
         : RuleCrontab::FieldRule(rule, TIMER_MAX_YEAR, TIMER_MIN_YEAR)
 {
 }
+RuleCrontab::YearRule::YearRule(const CrontabField& field)
+        : RuleCrontab::FieldRule(field, TIMER_MAX_YEAR, TIMER_MIN_YEAR)
+{
+}
 RuleCrontab::YearRule::YearRule(RuleCrontab::YearRule&& other)
     : RuleCrontab::FieldRule(std::move(other)) { }
 
 RuleCrontab::YearRule::~YearRule() { }
 
-std::tuple<Return, int> RuleCrontab::YearRule::GetNextValue(int curr_value)
+std::tuple<Return, int> RuleCrontab::YearRule::GetNextValue(int curr_value) const
 {
     if (!_parsed) return {Return::ESCHEDULE_RULE_INVALID, -1};
-    int next_value_min = -1;
-    Return ret = Return::ERROR;
-    for (auto rule : _rule_map) {
-        int next_value_tmp = -1;
-        Return ret_tmp = Return::SUCCESS;
-        switch (rule.first) {
-            case RuleType::Any:
-                next_value_tmp = curr_value + 1;
-                break;
-            case RuleType::Frequency:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found frequency in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 2) {
-                    TIMER_RULE_ERROR("Not found right frequency in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                next_value_tmp = curr_value + std::stoi(sm.str(1));
-            }
-            break;
-            case RuleType::Range:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 3) {
-                    TIMER_RULE_ERROR("Not found right range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (curr_value < std::stoi(sm.str(1))) {
-                    next_value_tmp = std::stoi(sm.str(1));
-                } else if (curr_value >= std::stoi(sm.str(2))) {
-                    ret_tmp = Return::ESCHEDULE_RULE_REACH_LIMIT;
-                } else {
-                    next_value_tmp = curr_value + 1;
-                }
-            }
-            break;
-            case RuleType::FrequencyRange:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)\\/([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found frequency & range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 4) {
-                    TIMER_RULE_ERROR("Not found right frequency & range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (curr_value < std::stoi(sm.str(1))) {
-                    next_value_tmp = std::stoi(sm.str(1));
-                } else if (curr_value >= std::stoi(sm.str(2))) {
-                    ret_tmp = Return::ESCHEDULE_RULE_REACH_LIMIT;
-                } else {
-                    next_value_tmp = curr_value + std::stoi(sm.str(3));
-                    if (next_value_tmp > std::stoi(sm.str(2))) {
-                        ret_tmp = Return::ESCHEDULE_RULE_REACH_LIMIT;
-                    }
-                }
-            }
-            break;
-            case RuleType::Value:
-                if (curr_value < std::stoi(rule.second)) {
-                    next_value_tmp = std::stoi(rule.second);
-                } else {
-                    ret_tmp = Return::ESCHEDULE_RULE_REACH_LIMIT;
-                }
-                break;
-            default:
-                return {Return::ESCHEDULE_RULE_INVALID, -1};
-        }
-        if (ret != Return::SUCCESS) {
-            ret = ret_tmp;
-        }
-        if (ret_tmp == Return::SUCCESS) {
-            if (next_value_min == -1) {
-                next_value_min = next_value_tmp;
-            } else {
-                next_value_min = next_value_tmp < next_value_min ? next_value_tmp : next_value_min;
-            }
-        }
-    }
-    if (next_value_min > TIMER_MAX_YEAR) {
-        ret = Return::ESCHEDULE_RULE_REACH_LIMIT;
+    int next_value = find_next_(curr_value + 1);
+    if (next_value == -1) {
+        return {Return::ESCHEDULE_RULE_REACH_LIMIT, -1};
     }
-    return {ret, next_value_min};
+    return {Return::SUCCESS, next_value};
 }
 
 //RuleCrontab::MonthRule
+const std::vector<std::string> RuleCrontab::MonthRule::Names = {
+    "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC",
+};
+
 RuleCrontab::MonthRule::MonthRule(std::string rule)
-        : RuleCrontab::FieldRule(rule, TIMER_MAX_MONTH, TIMER_MIN_MONTH)
+        : RuleCrontab::FieldRule(replace_names_(rule, Names, TIMER_MIN_MONTH), TIMER_MAX_MONTH, TIMER_MIN_MONTH)
 {
 }
 RuleCrontab::MonthRule::MonthRule(RuleCrontab::MonthRule&& other)
@@ -439,7 +444,8 @@ RuleCrontab::MonthRule::~MonthRule() { }
 
 //RuleCrontab::DayOfMonthRule
 RuleCrontab::DayOfMonthRule::DayOfMonthRule(std::string rule)
-        : RuleCrontab::FieldRule(rule, TIMER_MAX_DAYOFMONTH, TIMER_MIN_DAYOFMONTH)
+        : RuleCrontab::FieldRule(rule, TIMER_MAX_DAYOFMONTH, TIMER_MIN_DAYOFMONTH,
+                                 {RuleType::NoSpecific, RuleType::LastDay, RuleType::NearestWeekday, RuleType::LastWeekday})
 {
 }
 RuleCrontab::DayOfMonthRule::DayOfMonthRule(RuleCrontab::DayOfMonthRule&& other)
@@ -447,109 +453,14 @@ RuleCrontab::DayOfMonthRule::DayOfMonthRule(RuleCrontab::DayOfMonthRule&& other)
 
 RuleCrontab::DayOfMonthRule::~DayOfMonthRule() { }
 
-std::tuple<Return, int> RuleCrontab::DayOfMonthRule::GetNextValue(int curr_value)
-{
-    if (!_parsed) return {Return::ESCHEDULE_RULE_INVALID, -1};
-    auto start_days = std::chrono::floor<std::chrono::days>(_last_time);
-    auto start_year = std::chrono::year_month_day(start_days).year();
-    auto start_month = std::chrono::year_month_day(start_days).month();
-    _field_max_value = GetMonthMaxDays((int)start_year, (unsigned int)start_month);
-    TIMER_RULE_ERROR("---grh--- max [", _field_max_value, "]");
-    int next_value_min = -1;
-    for (auto rule : _rule_map) {
-        int next_value_tmp = -1;
-        switch (rule.first) {
-            case RuleType::Any:
-                next_value_tmp = curr_value + 1;
-                break;
-            case RuleType::Frequency:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found frequency in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 2) {
-                    TIMER_RULE_ERROR("Not found right frequency in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                next_value_tmp = curr_value + std::stoi(sm.str(1));
-            }
-            break;
-            case RuleType::Range:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 3) {
-                    TIMER_RULE_ERROR("Not found right range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (curr_value < std::stoi(sm.str(1))) {
-                    next_value_tmp = std::stoi(sm.str(1));
-                } else if (curr_value >= std::stoi(sm.str(2))) {
-                    next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(sm.str(1));
-                } else {
-                    next_value_tmp = curr_value + 1;
-                }
-            }
-            break;
-            case RuleType::FrequencyRange:
-            {
-                std::smatch sm;
-                if (!std::regex_search(rule.second, sm, std::regex("([0-9]+)\\-([0-9]+)\\/([0-9]+)"))) {
-                    TIMER_RULE_ERROR("Not found frequency & range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (sm.size() != 4) {
-                    TIMER_RULE_ERROR("Not found right frequency & range in rule[" , rule.second, "]");
-                    _parsed = false;
-                    return {Return::ESCHEDULE_RULE_INVALID, -1};
-                }
-                if (curr_value < std::stoi(sm.str(1))) {
-                    next_value_tmp = std::stoi(sm.str(1));
-                } else if (curr_value >= std::stoi(sm.str(2))) {
-                    next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(sm.str(1));
-                } else {
-                    next_value_tmp = curr_value + std::stoi(sm.str(3));
-                    if (next_value_tmp > std::stoi(sm.str(2))) {
-                        next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(sm.str(1));
-                    }
-                }
-            }
-            break;
-            case RuleType::Value:
-                if (curr_value < std::stoi(rule.second)) {
-                    next_value_tmp = std::stoi(rule.second);
-                } else {
-                    next_value_tmp = _field_max_value - _field_min_value + 1 + std::stoi(rule.second);
-                }
-                break;
-            default:
-                return {Return::ESCHEDULE_RULE_INVALID, -1};
-        }
-        if (next_value_min == -1) {
-            next_value_min = next_value_tmp;
-        } else {
-            next_value_min = next_value_tmp < next_value_min ? next_value_tmp : next_value_min;
-        }
-    }
-    return {Return::SUCCESS, next_value_min};
-    
-
-    return {Return::SUCCESS, curr_value};
-}
-
 //RuleCrontab::DayOfWeekRule
+const std::vector<std::string> RuleCrontab::DayOfWeekRule::Names = {
+    "MON", "TUE", "WED", "THU", "FRI", "SAT", "SUN",
+};
+
 RuleCrontab::DayOfWeekRule::DayOfWeekRule(std::string rule)
-        : RuleCrontab::FieldRule(rule, TIMER_MAX_DAYOFWEEK, TIMER_MIN_DAYOFWEEK)
+        : RuleCrontab::FieldRule(replace_names_(rule, Names, TIMER_MIN_DAYOFWEEK), TIMER_MAX_DAYOFWEEK, TIMER_MIN_DAYOFWEEK,
+                                 {RuleType::NoSpecific, RuleType::NthDayOfWeek, RuleType::LastDayOfWeek})
 {
 }
 RuleCrontab::DayOfWeekRule::DayOfWeekRule(RuleCrontab::DayOfWeekRule&& other)
@@ -590,7 +501,7 @@ RuleCrontab::SecondRule::~SecondRule() { }
 //RuleCrontab
 RuleCrontab::RuleCrontab(std::string rule) : _parsed(false), _raw_rule(rule)
 {
-    _start_time = std::chrono::system_clock::now();
+    _start_time = Clock::Instance().ToWall(Clock::Instance().Cached());
     parse_rule_();
 }
 
@@ -600,6 +511,26 @@ RuleCrontab::RuleCrontab(RefTimePoint start_time, std::string rule)
     parse_rule_();
 }
 
+RuleCrontab::RuleCrontab(std::string rule, std::string zone)
+        : _parsed(false), _raw_rule(rule), _zone(Zone::Locate(zone))
+{
+    _start_time = Clock::Instance().ToWall(Clock::Instance().Cached());
+    parse_rule_();
+}
+
+RuleCrontab::RuleCrontab(RefTimePoint start_time, std::string rule, std::string zone)
+        : _parsed(false), _raw_rule(rule), _start_time(start_time), _zone(Zone::Locate(zone))
+{
+    parse_rule_();
+}
+
+RuleCrontab::RuleCrontab(const CrontabFields& fields, std::string rule, std::string zone)
+        : _parsed(false), _raw_rule(rule), _zone(zone.empty() ? nullptr : Zone::Locate(zone))
+{
+    _start_time = Clock::Instance().ToWall(Clock::Instance().Cached());
+    load_rule_(fields);
+}
+
 RuleCrontab::~RuleCrontab()
 {
     for (auto it : _crontab_rule) {
@@ -607,364 +538,358 @@ RuleCrontab::~RuleCrontab()
     }
 }
 
-bool RuleCrontab::Valid(WheelAccuracy& accuracy)
+bool RuleCrontab::Valid(WheelAccuracy& accuracy) const
 {
-    if (!_parsed) return false;
-    std::ignore = accuracy;
-    return true;
+    if (!_parsed || !accuracy.Valid()) {
+        return false;
+    }
+    long long tick = accuracy.GetAccuracy().count();
+    long long second = std::chrono::nanoseconds(std::chrono::seconds(1)).count();
+    return (tick <= second && second % tick == 0);
 }
 
 std::tuple<Return, WheelScale>
-RuleCrontab::GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy)
+RuleCrontab::GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy) const
 {
-    std::ignore = reftime;
-    std::ignore = accuracy;
-    return std::make_tuple(Return(Return::ESCHEDULE_RULE_INVALID), WheelScale());
+    if (!Valid(accuracy)) {
+        return std::make_tuple(Return(Return::ESCHEDULE_RULE_INVALID), WheelScale());
+    }
+    auto ret = GetNextExprieTime(RefTimePoint(reftime));
+    if (std::get<0>(ret) != Return::SUCCESS) {
+        return std::make_tuple(std::get<0>(ret), WheelScale());
+    }
+    long long tick = accuracy.GetAccuracy().count();
+    long long distance = (std::get<1>(ret) - reftime).count();
+    return std::make_tuple(Return(Return::SUCCESS), WheelScale((distance + tick - 1) / tick));
 }
 
-int RuleCrontab::get_field_value_(RefTimePoint&& time, Field&& field)
+int RuleCrontab::get_field_value_(const Calendar& calendar, Field field) const
 {
-    auto curr_days = std::chrono::floor<std::chrono::days>(time);
-    std::chrono::hh_mm_ss curr_time(time - curr_days);
     switch (field) {
         case Year:
-            return ((int)std::chrono::year_month_day(curr_days).year());
+            return calendar.GetYear();
         case Month:
-            return ((unsigned int)std::chrono::year_month_day(curr_days).month());
+            return calendar.GetMonth();
         case DayOfMonth:
-            return ((unsigned int)std::chrono::year_month_day(curr_days).day());
+            return calendar.GetDayOfMonth();
         case DayOfWeek:
-            return std::chrono::year_month_weekday(curr_days).weekday().c_encoding();
+            return calendar.GetDayOfWeek();
         case Hour:
-            return curr_time.hours().count();
+            return calendar.GetHour();
         case Minute:
-            return curr_time.minutes().count();
+            return calendar.GetMinute();
         case Second:
-            return curr_time.seconds().count();
+            return calendar.GetSecond();
         default:
             return -1;
     }
 }
-void RuleCrontab::set_field_value_(RefTimePoint&& time, Field&& field, int value)
+
+uint64_t RuleCrontab::GetDayMask(const Calendar& calendar) const
 {
-    auto curr_days = std::chrono::floor<std::chrono::days>(time);
-    std::chrono::hh_mm_ss curr_time(time - curr_days);
-    switch (field) {
-        case Year:
-        {
-            int year;
-            if (value < (int)std::chrono::year_month_day(curr_days).year()) {
-                year = 0;
-            } else {
-                year = value - (int)std::chrono::year_month_day(curr_days).year();
+    const FieldRule* monthday_rule = _fields[Field::DayOfMonth];
+    const FieldRule* weekday_rule = _fields[Field::DayOfWeek];
+    int month_days = calendar.GetMonthDays();
+    int first_weekday = calendar.GetFirstWeekday();
+    uint64_t valid = ((1ULL << month_days) - 1) << 1;
+    auto weekday_of = [&](int day) { return (first_weekday - 1 + day - 1) % 7 + 1; };
+    auto nearest_weekday = [&](int day) {
+        if (weekday_of(day) == 6) {
+            return (day == 1) ? day + 2 : day - 1;
+        } else if (weekday_of(day) == 7) {
+            return (day == month_days) ? day - 2 : day + 1;
+        }
+        return day;
+    };
+
+    uint64_t monthday = monthday_rule->_mask[0] & valid;
+    if (monthday_rule->HasSpecial()) {
+        for (uint64_t bits = monthday_rule->_last_mask; bits; bits &= bits - 1) {
+            int day = month_days - std::countr_zero(bits);
+            if (day >= TIMER_MIN_DAYOFMONTH) {
+                monthday |= (1ULL << day);
             }
-            time += std::chrono::years(year);
         }
-        break;
-        case Month:
-        {
-            int month;
-            if ((unsigned int)value < (unsigned int)std::chrono::year_month_day(curr_days).month()) {
-                month = value + TIMER_MONTH_COUNT - (unsigned int)std::chrono::year_month_day(curr_days).month();
-            } else {
-                month = value - (unsigned int)std::chrono::year_month_day(curr_days).month();
+        for (uint64_t bits = monthday_rule->_nearest_mask; bits; bits &= bits - 1) {
+            if (std::countr_zero(bits) <= month_days) {
+                monthday |= (1ULL << nearest_weekday(std::countr_zero(bits)));
             }
-            time += std::chrono::months(month);
         }
-        break;
-        case DayOfMonth:
-        {
-            int monthdays;
-            if ((unsigned int)value < (unsigned int)std::chrono::year_month_day(curr_days).day()) {
-                monthdays = value + TIMER_DAYOFMONTH_COUNT - (unsigned int)std::chrono::year_month_day(curr_days).day();
+        if (monthday_rule->_last_weekday) {
+            int day = month_days;
+            while (weekday_of(day) > 5) {
+                --day;
+            }
+            monthday |= (1ULL << day);
+        }
+    }
+
+    // Plain weekdays are precomputed per first weekday, see compile_reach_.
+    uint64_t weekday = _weekday_days[first_weekday - 1];
+    if (weekday_rule->HasSpecial()) {
+        for (int day_of_week = TIMER_MIN_DAYOFWEEK; day_of_week <= TIMER_MAX_DAYOFWEEK; ++day_of_week) {
+            int first = 1 + (day_of_week - first_weekday + 7) % 7;
+            for (int nth = 1; nth <= 5; ++nth) {
+                if ((weekday_rule->_nth_mask >> ((day_of_week - 1) * 8 + nth)) & 1) {
+                    weekday |= (1ULL << (first + 7 * (nth - 1)));
+                }
+            }
+            if ((weekday_rule->_last_mask >> day_of_week) & 1) {
+                weekday |= (1ULL << (first + 7 * ((month_days - first) / 7)));
+            }
+        }
+    }
+    weekday &= valid;
+
+    // Both day fields restricted: either one may match, as crontab does.
+    return _day_union ? (monthday | weekday) : (monthday & weekday);
+}
+
+Return RuleCrontab::gen_next_time_(Calendar& calendar) const
+{
+    int days_month = 0;
+    uint64_t days = 0;
+    // Expired year range or impossible day, known without walking.
+    if (calendar.GetYear() > _last_year) {
+        return Return::ESCHEDULE_RULE_REACH_LIMIT;
+    }
+    while (calendar.GetYear() <= TIMER_MAX_YEAR) {
+        int value = get_field_value_(calendar, Field::Year);
+        if (!_fields[Field::Year]->CheckValue(value)) {
+            auto ret = _fields[Field::Year]->GetNextValue(value);
+            if (std::get<0>(ret) != Return::SUCCESS) {
+                return std::get<0>(ret);
+            }
+            calendar.SetYear(std::get<1>(ret));
+            continue;
+        }
+
+        // Months without any possible day are skipped with the month mask.
+        value = get_field_value_(calendar, Field::Month);
+        if (!((_reach_months >> value) & 1)) {
+            uint64_t next_months = _reach_months & (~0ULL << (value + 1));
+            if (next_months) {
+                calendar.SetMonth(std::countr_zero(next_months));
             } else {
-                monthdays = value - (unsigned int)std::chrono::year_month_day(curr_days).day();
+                calendar.NextYear();
             }
-            time += std::chrono::days(monthdays);
+            continue;
         }
-        break;
-        case DayOfWeek:
-        {
-            int weekdays;
-            if ((unsigned int)value < std::chrono::year_month_weekday(curr_days).weekday().c_encoding()) {
-                weekdays = value + TIMER_DAYOFWEEK_COUNT - std::chrono::year_month_weekday(curr_days).weekday().c_encoding();
+
+        // Matching days are resolved once per month, then found by bit scan.
+        if (days_month != calendar.GetYear() * 12 + calendar.GetMonth()) {
+            days_month = calendar.GetYear() * 12 + calendar.GetMonth();
+            days = GetDayMask(calendar);
+        }
+        value = get_field_value_(calendar, Field::DayOfMonth);
+        if (!((days >> value) & 1)) {
+            uint64_t next_days = days & (~0ULL << (value + 1));
+            if (next_days) {
+                calendar.SetDayOfMonth(std::countr_zero(next_days));
             } else {
-                weekdays = value - std::chrono::year_month_weekday(curr_days).weekday().c_encoding();
+                calendar.NextMonth();
             }
-            time += std::chrono::days(weekdays);
+            continue;
         }
-        break;
-        case Hour:
-        {
-            int hours;
-            if (value < curr_time.hours().count()) {
-                hours = value + TIMER_HOUR_COUNT - curr_time.hours().count();
+
+        value = get_field_value_(calendar, Field::Hour);
+        if (!_fields[Field::Hour]->CheckValue(value)) {
+            auto ret = _fields[Field::Hour]->GetNextValue(value);
+            if (std::get<0>(ret) != Return::SUCCESS) {
+                return std::get<0>(ret);
+            }
+            if (std::get<1>(ret) > TIMER_MAX_HOUR) {
+                calendar.NextDay();
             } else {
-                hours = value - curr_time.hours().count();
+                calendar.SetHour(std::get<1>(ret));
             }
-            time += std::chrono::hours(hours);
+            continue;
         }
-        break;
-        case Minute:
-        {
-            int minutes;
-            if (value < curr_time.minutes().count()) {
-                minutes = value + TIMER_MINUTE_COUNT - curr_time.minutes().count();
+
+        value = get_field_value_(calendar, Field::Minute);
+        if (!_fields[Field::Minute]->CheckValue(value)) {
+            auto ret = _fields[Field::Minute]->GetNextValue(value);
+            if (std::get<0>(ret) != Return::SUCCESS) {
+                return std::get<0>(ret);
+            }
+            if (std::get<1>(ret) > TIMER_MAX_MINUTE) {
+                calendar.NextHour();
             } else {
-                minutes = value - curr_time.minutes().count();
+                calendar.SetMinute(std::get<1>(ret));
             }
-            time += std::chrono::minutes(minutes);
+            continue;
         }
-        break;
-        case Second:
-        {
-            int seconds;
-            if (value < curr_time.seconds().count()) {
-                seconds = value + TIMER_SECOND_COUNT - curr_time.seconds().count();
+
+        value = get_field_value_(calendar, Field::Second);
+        if (!_fields[Field::Second]->CheckValue(value)) {
+            auto ret = _fields[Field::Second]->GetNextValue(value);
+            if (std::get<0>(ret) != Return::SUCCESS) {
+                return std::get<0>(ret);
+            }
+            if (std::get<1>(ret) > TIMER_MAX_SECOND) {
+                calendar.NextMinute();
             } else {
-                seconds = value - curr_time.seconds().count();
+                calendar.SetSecond(std::get<1>(ret));
             }
-            time += std::chrono::seconds(seconds);
+            continue;
         }
-        break;
-        default:
-            break;
+        return Return::SUCCESS;
     }
+    return Return::ESCHEDULE_RULE_REACH_LIMIT;
 }
 
-Return RuleCrontab::gen_next_time_(RefTimePoint& next_time, Field&& field)
+std::tuple<Return, RuleCrontab::RefTimePoint>
+RuleCrontab::GetNextExprieTime(RefTimePoint&& reftime) const
 {
-    TIMER_RULE_ERROR("--grh-- [", __LINE__,"]");
-    int field_value = get_field_value_(std::move(next_time), std::forward<Field>(field));
-    if (!_crontab_rule[field]->CheckValue(field_value)) {
-        _crontab_rule[field]->SetLastTime(std::move(next_time));
-        auto ret = _crontab_rule[field]->GetNextValue(field_value);
-
-        if (std::get<0>(ret) != Return::SUCCESS) {
-            return std::get<0>(ret);
+    if (!_parsed) {
+        return {Return::ESCHEDULE_RULE_INVALID, reftime};
+    }
+    RefTimePoint next;
+    if (memo_find_(reftime, next)) {
+        return {Return::SUCCESS, next};
+    }
+    if (_zone) {
+        auto ret = get_next_zone_time_(reftime);
+        if (std::get<0>(ret) == Return::SUCCESS) {
+            memo_store_(reftime, std::get<1>(ret));
         }
-        set_field_value_(std::move(next_time), std::forward<Field>(field), std::get<1>(ret));
+        return ret;
     }
-    if (field > Field::Begin) {
-        return gen_next_time_(next_time, (Field)(field - 1));
+    // Decompose once, the search then only moves calendar fields forward.
+    Calendar calendar(std::chrono::floor<std::chrono::seconds>(reftime) + std::chrono::seconds(1));
+    Return ret = gen_next_time_(calendar);
+    if (ret != Return::SUCCESS) {
+        return {ret, reftime};
     }
-    return Return::SUCCESS;
+    next = calendar.GetTimePoint();
+    memo_store_(reftime, next);
+    return {Return::SUCCESS, next};
 }
 
-std::tuple<Return, RuleCrontab::RefTimePoint>
-RuleCrontab::GetNextExprieTime(RefTimePoint&& reftime)
-{
-    RuleCrontab::RefTimePoint next_time = reftime;
-    gen_next_time_(next_time, Field::Second);
-#if 0
-    auto curr_days = std::chrono::floor<std::chrono::days>(reftime);
-    std::chrono::hh_mm_ss curr_time(reftime - curr_days);
-//    int curr_month = (unsigned int)std::chrono::year_month_day(curr_days).month();
-
-    int second;
-    int curr_second = curr_time.seconds().count();
-    auto second_ret = _crontab_rule[Field::Second]->GetNextValue(curr_second);
-    if (std::get<0>(second_ret) == Return::SUCCESS) {
-        second = std::get<1>(second_ret);
-    } else {
-        return {std::get<0>(second_ret), next_time};
-    }
-    if (second <= TIMER_MAX_SECOND) {
-        next_time = std::chrono::floor<std::chrono::minutes>(reftime)
-                    + std::chrono::seconds(second);
-        return {Return::SUCCESS, next_time};
-    }
-
-    int minute;
-    int curr_minute = curr_time.minutes().count();
-    int tmp_minute = curr_minute;
-    int minute_len = 0;
-    do {
-        auto minute_ret = _crontab_rule[Field::Minute]->GetNextValue(tmp_minute);
-        if (std::get<0>(minute_ret) == Return::SUCCESS) {
-            minute = std::get<1>(minute_ret);
-        } else {
-            return {std::get<0>(minute_ret), next_time};
-        }
-        minute_len += minute - tmp_minute;
-        tmp_minute = minute % TIMER_MINUTE_COUNT;
-    } while (minute - curr_minute < second / TIMER_SECOND_COUNT);
-    if (minute_len % (second / TIMER_SECOND_COUNT) == 0) {
-        if (minute <= TIMER_MAX_MINUTE) {
-            next_time = std::chrono::floor<std::chrono::hours>(reftime)
-                        + std::chrono::minutes(minute)
-                        + std::chrono::seconds(second % TIMER_SECOND_COUNT);
-            return {Return::SUCCESS, next_time};
-        }
-    } else {
-        return {Return::ESCHEDULE_RULE_CONFLICT, next_time};
-    }
-
-    int hour;
-    TIMER_RULE_ERROR("--grh-- [", __LINE__,"]");
-    int curr_hour = curr_time.hours().count();
-    int tmp_hour = curr_hour;
-    int hour_len = 0;
-    do {
-        auto hour_ret = _crontab_rule[Field::Hour]->GetNextValue(tmp_hour);
-        if (std::get<0>(hour_ret) == Return::SUCCESS) {
-            hour = std::get<1>(hour_ret);
-        } else {
-            return {std::get<0>(hour_ret), next_time};
-        }
-        hour_len += hour - tmp_hour;
-        tmp_hour = hour % TIMER_HOUR_COUNT;
-    } while (hour - curr_hour < minute / TIMER_MINUTE_COUNT);
-    if (hour_len % (minute / TIMER_MINUTE_COUNT) == 0) {
-        if (hour <= TIMER_MAX_HOUR) {
-            next_time = std::chrono::floor<std::chrono::days>(reftime)
-                        + std::chrono::hours(hour)
-                        + std::chrono::minutes(minute % TIMER_MINUTE_COUNT)
-                        + std::chrono::seconds(second % TIMER_SECOND_COUNT);
-            return {Return::SUCCESS, next_time};
-        }
-    } else {
-        return {Return::ESCHEDULE_RULE_CONFLICT, next_time};
-    }
-
-    int curr_year = (int)std::chrono::year_month_day(curr_days).year();
-    int curr_month = (unsigned int)std::chrono::year_month_day(curr_days).month();
-    int curr_day = (unsigned int)std::chrono::year_month_day(curr_days).day();
-    int curr_weekday = std::chrono::year_month_weekday(curr_days).weekday().c_encoding();
-
-    int weekday;
-    int monthday;
-    int tmp_weekday = curr_weekday;
-    int tmp_monthday = curr_day;
-    int tmp_day_len = 0;
-    do {
-        auto tmp_last_time = reftime + std::chrono::days(tmp_day_len);
-        _crontab_rule[Field::DayOfMonth]->SetLastTime(std::move(tmp_last_time));
-        auto weekday_ret = _crontab_rule[Field::DayOfWeek]->GetNextValue(tmp_weekday);
-        if (std::get<0>(weekday_ret) == Return::SUCCESS) {
-            weekday = std::get<1>(weekday_ret);
-        } else {
-            return {std::get<0>(weekday_ret), next_time};
-        }
-        int weekday_len = weekday - tmp_weekday;
-    TIMER_RULE_ERROR("--grh-- [", __LINE__,"] weekday [", weekday, "] len [", weekday_len, "]");
+bool RuleCrontab::memo_find_(const RefTimePoint& reftime, RefTimePoint& next) const
+{
+    unsigned seq = _memo.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+        return false;
+    }
+    long long from = _memo.from.load(std::memory_order_relaxed);
+    long long until = _memo.next.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_memo.seq.load(std::memory_order_relaxed) != seq) {
+        return false;
+    }
+    // No fire in [from, until), so every reftime in it fires next at until.
+    long long time = reftime.time_since_epoch().count();
+    if (time < from || time >= until) {
+        return false;
+    }
+    next = RefTimePoint(std::chrono::nanoseconds(until));
+    return true;
+}
 
-        auto monthday_ret = _crontab_rule[Field::DayOfMonth]->GetNextValue(tmp_monthday);
-        if (std::get<0>(monthday_ret) == Return::SUCCESS) {
-            monthday = std::get<1>(monthday_ret);
-        } else {
-            return {std::get<0>(monthday_ret), next_time};
-        }
-        int monthday_len = monthday - tmp_monthday;
-    TIMER_RULE_ERROR("--grh-- [", __LINE__,"] monthday [", monthday, "] len [", monthday_len, "]");
-        int day_len = weekday_len < monthday_len ? weekday_len : monthday_len;
-        tmp_day_len += day_len;
-
-        tmp_weekday = (tmp_weekday + day_len) % TIMER_DAYOFWEEK_COUNT;
-        tmp_monthday += day_len;
-        int tmp_curr_month = (unsigned int)(std::chrono::year_month_day(std::chrono::floor<std::chrono::days>(tmp_last_time)).month());
-        int tmp_curr_year = (int)(std::chrono::year_month_day(std::chrono::floor<std::chrono::days>(tmp_last_time)).year());
-        while(tmp_monthday > GetMonthMaxDays(tmp_curr_year, tmp_curr_month)) {
-            tmp_monthday -= GetMonthMaxDays(tmp_curr_year, tmp_curr_month);
-            tmp_curr_month++;
-            tmp_curr_year += tmp_curr_month / TIMER_MONTH_COUNT;
-            tmp_curr_month = tmp_curr_month % TIMER_MONTH_COUNT;
-        }
-    } while (tmp_day_len < hour / TIMER_HOUR_COUNT);
-    TIMER_RULE_ERROR("--grh-- [", __LINE__,"] tmp_day_len [", tmp_day_len, "]");
-    TIMER_RULE_ERROR("--grh-- [", __LINE__,"] hour [", hour % TIMER_HOUR_COUNT, "]");
-    if (tmp_day_len % (hour / TIMER_HOUR_COUNT) == 0) {
-        if ((curr_day + tmp_day_len) < GetMonthMaxDays(curr_year, curr_month)) {
-            next_time = std::chrono::floor<std::chrono::days>(reftime)
-                        + std::chrono::days(tmp_day_len)
-                        + std::chrono::hours(hour % TIMER_HOUR_COUNT)
-                        + std::chrono::minutes(minute % TIMER_MINUTE_COUNT)
-                        + std::chrono::seconds(second % TIMER_SECOND_COUNT);
-            return {Return::SUCCESS, next_time};
-        }
-    } else {
-        return {Return::ESCHEDULE_RULE_CONFLICT, next_time};
-    }
-
-    int exceed_month = 0;
-    int tmp_exceed_curr_month = curr_month;
-    int tmp_exceed_curr_year = curr_year;
-    int tmp_exceed_monthday = curr_day + tmp_day_len;
-    while(tmp_exceed_monthday > GetMonthMaxDays(tmp_exceed_curr_year, tmp_exceed_curr_month)) {
-        tmp_exceed_monthday -= GetMonthMaxDays(tmp_exceed_curr_year, tmp_exceed_curr_month);
-        tmp_exceed_curr_month++;
-        tmp_exceed_curr_year += tmp_exceed_curr_month / TIMER_MONTH_COUNT;
-        tmp_exceed_curr_month = tmp_exceed_curr_month % TIMER_MONTH_COUNT;
-        exceed_month++;
-    }
-
-    int month;
-    int tmp_month = curr_month;
-    int month_len = 0;
-    do {
-        auto month_ret = _crontab_rule[Field::Month]->GetNextValue(tmp_month);
-        if (std::get<0>(month_ret) == Return::SUCCESS) {
-            month = std::get<1>(month_ret);
-        } else {
-            return {std::get<0>(month_ret), next_time};
+void RuleCrontab::memo_store_(const RefTimePoint& reftime, const RefTimePoint& next) const
+{
+    unsigned seq = _memo.seq.load(std::memory_order_relaxed);
+    // Another writer at work, its window is as good as this one.
+    if ((seq & 1) || !_memo.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    _memo.from.store(reftime.time_since_epoch().count(), std::memory_order_relaxed);
+    _memo.next.store(next.time_since_epoch().count(), std::memory_order_relaxed);
+    _memo.seq.store(seq + 2, std::memory_order_release);
+}
+
+std::tuple<Return, RuleCrontab::RefTimePoint>
+RuleCrontab::get_next_zone_time_(const RefTimePoint& reftime) const
+{
+    // Fields are matched on local wall time, only the two ends are converted.
+    Calendar calendar(std::chrono::floor<std::chrono::seconds>(_zone->ToLocal(reftime)) + std::chrono::seconds(1));
+    while (true) {
+        Return ret = gen_next_time_(calendar);
+        if (ret != Return::SUCCESS) {
+            return {ret, reftime};
         }
-        month_len += (month - tmp_month);
-        tmp_month = month;
-    } while (month_len < exceed_month);
-    if (month % exceed_month == 0) {
-        if (month < TIMER_MAX_MONTH) {
-            next_time = std::chrono::floor<std::chrono::months>(reftime)
-                        + std::chrono::months(month)
-                        + std::chrono::days(tmp_exceed_monthday)
-                        + std::chrono::hours(hour % TIMER_HOUR_COUNT)
-                        + std::chrono::minutes(minute % TIMER_MINUTE_COUNT)
-                        + std::chrono::seconds(second % TIMER_SECOND_COUNT);
-            return {Return::SUCCESS, next_time};
+        auto utc = _zone->ToUTC(calendar.GetTimePoint(), reftime);
+        if (std::get<0>(utc) == Return::SUCCESS) {
+            return utc;
         }
+        // Local time repeated by a backward transition and already passed.
+        calendar.NextSecond();
     }
-#endif
-    return {Return::SUCCESS, next_time};
 }
 
 std::tuple<Return, RuleCrontab::RefTimePoint>
-RuleCrontab::GetNextExprieTime()
+RuleCrontab::GetNextExprieTime() const
 {
-    if (_last_time.time_since_epoch().count() == 0) {
-        _last_time = _start_time;
-        return {Return::SUCCESS, _last_time};
-    }
-    return GetNextExprieTime(std::move(_last_time));
+    return GetNextExprieTime(RefTimePoint(_start_time));
+}
+
+const RuleCrontab::RefTimePoint& RuleCrontab::GetStartTime() const
+{
+    return _start_time;
+}
+
+const std::shared_ptr<const Zone>& RuleCrontab::GetZone() const
+{
+    return _zone;
+}
+
+bool RuleCrontab::Parsed() const
+{
+    return _parsed;
+}
+
+const std::vector<uint64_t>& RuleCrontab::GetFieldMask(Field field) const
+{
+    return _crontab_rule.at(field)->GetMask();
+}
+
+bool RuleCrontab::IsDayUnion() const
+{
+    return (!_crontab_rule.at(Field::DayOfMonth)->IsAny() && !_crontab_rule.at(Field::DayOfWeek)->IsAny());
+}
+
+bool RuleCrontab::HasDaySpecial() const
+{
+    return (_crontab_rule.at(Field::DayOfMonth)->HasSpecial() || _crontab_rule.at(Field::DayOfWeek)->HasSpecial());
 }
 
 int RuleCrontab::GetMonthMaxDays(int year, int month)
 {
-    switch (month) {
-        case 1:
-        case 3:
-        case 5:
-        case 7:
-        case 8:
-        case 10:
-        case 12:
-            return 31;
-        case 2:
-            if ((((int)year) % 400 == 0) || (((int)year) % 4 == 0 && ((int)year) % 100 != 0)) {
-                return 29;
-            } else {
-                return 28;
+    return Calendar::GetMonthDays(year, month);
+}
+
+std::string RuleCrontab::Normalize(const std::string& rule)
+{
+    std::string normalized;
+    normalized.reserve(rule.size());
+    for (unsigned char c : rule) {
+        if (c == ' ' || c == '\t') {
+            if (!normalized.empty() && normalized.back() != ' ') {
+                normalized.push_back(' ');
             }
-            break;
-        default:
-            return 30;
+            continue;
+        }
+        normalized.push_back((char)std::toupper(c));
+    }
+    if (!normalized.empty() && normalized.back() == ' ') {
+        normalized.pop_back();
     }
+    return normalized;
 }
 
 void RuleCrontab::parse_rule_()
 {
-    std::regex word_regex("[^ ]+");
+    static const std::regex word_regex("[^ ]+");
     auto words_begin = std::sregex_iterator(_raw_rule.begin(), _raw_rule.end(), word_regex);
     auto words_end = std::sregex_iterator();
     int field_index = Field::Begin;
+    _parsed = true;
+    _fields.fill(nullptr);
+    _day_union = false;
+    _last_year = -1;
+    _reach_months = 0;
     for (std::sregex_iterator i = words_begin; i != words_end; ++i) {
         if (field_index > Field::End) {
             _parsed = false;
@@ -978,8 +903,109 @@ void RuleCrontab::parse_rule_()
             //return;
         }
         _crontab_rule.insert({field_index, field_rule_p});
+        _fields[field_index] = field_rule_p;
         ++field_index;
     }
+    if (field_index <= Field::End) {
+        TIMER_RULE_ERROR("Rule[", _raw_rule, "] has too few fields");
+        _parsed = false;
+    }
+    finish_rule_();
+}
+
+void RuleCrontab::load_rule_(const CrontabFields& fields)
+{
+    // Checked and compiled by CrontabParser, only the masks are copied.
+    _parsed = true;
+    _fields.fill(nullptr);
+    _day_union = false;
+    _last_year = -1;
+    _reach_months = 0;
+    for (int field_index = Field::Begin; field_index <= Field::End; ++field_index) {
+        const CrontabField& field = fields.field[field_index];
+        FieldRule* field_rule_p = nullptr;
+        switch (field_index) {
+            case Field::Year:
+                field_rule_p = new RuleCrontab::YearRule(field);
+                break;
+            case Field::Month:
+                field_rule_p = new RuleCrontab::FieldRule(field, TIMER_MAX_MONTH, TIMER_MIN_MONTH);
+                break;
+            case Field::DayOfMonth:
+                field_rule_p = new RuleCrontab::FieldRule(field, TIMER_MAX_DAYOFMONTH, TIMER_MIN_DAYOFMONTH);
+                break;
+            case Field::DayOfWeek:
+                field_rule_p = new RuleCrontab::FieldRule(field, TIMER_MAX_DAYOFWEEK, TIMER_MIN_DAYOFWEEK);
+                break;
+            case Field::Hour:
+                field_rule_p = new RuleCrontab::FieldRule(field, TIMER_MAX_HOUR, TIMER_MIN_HOUR);
+                break;
+            case Field::Minute:
+                field_rule_p = new RuleCrontab::FieldRule(field, TIMER_MAX_MINUTE, TIMER_MIN_MINUTE);
+                break;
+            case Field::Second:
+                field_rule_p = new RuleCrontab::FieldRule(field, TIMER_MAX_SECOND, TIMER_MIN_SECOND);
+                break;
+        }
+        _crontab_rule.insert({field_index, field_rule_p});
+        _fields[field_index] = field_rule_p;
+    }
+    finish_rule_();
+}
+
+void RuleCrontab::finish_rule_()
+{
+    if (_zone && !_zone->Valid()) {
+        TIMER_RULE_ERROR("Rule[", _raw_rule, "] zone[", _zone->GetName(), "] invalid");
+        _parsed = false;
+    }
+    if (_parsed) {
+        compile_reach_();
+    }
+}
+
+void RuleCrontab::compile_reach_()
+{
+    // Days of one weekday repeat every 7 bits from its first day in the
+    // month, so plain weekdays only depend on the month's first weekday.
+    _day_union = IsDayUnion();
+    for (int first_weekday = TIMER_MIN_DAYOFWEEK; first_weekday <= TIMER_MAX_DAYOFWEEK; ++first_weekday) {
+        uint64_t days = 0;
+        for (int day_of_week = TIMER_MIN_DAYOFWEEK; day_of_week <= TIMER_MAX_DAYOFWEEK; ++day_of_week) {
+            if ((_fields[Field::DayOfWeek]->_mask[0] >> day_of_week) & 1) {
+                days |= (0x10204081ULL << (1 + (day_of_week - first_weekday + 7) % 7));
+            }
+        }
+        _weekday_days[first_weekday - 1] = days;
+    }
+
+    const std::vector<uint64_t>& year_mask = _fields[Field::Year]->GetMask();
+    bool leap = false;
+    for (int year = TIMER_MAX_YEAR; year >= TIMER_MIN_YEAR; --year) {
+        if ((size_t)(year >> 6) < year_mask.size() && ((year_mask[year >> 6] >> (year & 63)) & 1)) {
+            _last_year = (_last_year < 0) ? year : _last_year;
+            leap = leap || Calendar::IsLeapYear(year);
+        }
+    }
+
+    // A plain day of month field (e.g. 31, or 30 in February) can rule out
+    // months for good. Weekdays and L/W/# always hit some day of a month.
+    const FieldRule* monthday_rule = _fields[Field::DayOfMonth];
+    uint64_t months = _fields[Field::Month]->GetMask()[0];
+    if (!monthday_rule->IsAny() && !IsDayUnion() && !HasDaySpecial()) {
+        for (int month = TIMER_MIN_MONTH; month <= TIMER_MAX_MONTH; ++month) {
+            // Longest the month gets within the year range.
+            int days = Calendar::GetMonthDays(leap ? 2000 : 2001, month);
+            if (!(monthday_rule->GetMask()[0] & (((1ULL << days) - 1) << 1))) {
+                months &= ~(1ULL << month);
+            }
+        }
+    }
+    _reach_months = months;
+    if (!_reach_months) {
+        TIMER_RULE_ERROR("Rule[", _raw_rule, "] never matches a day");
+        _last_year = -1;
+    }
 }
 
 RuleCrontab::FieldRule* RuleCrontab::parse_field_rule_(int field, std::string rule)
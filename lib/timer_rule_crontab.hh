@@ -2,10 +2,16 @@
 #define __TIMER_RULE_CRONTAB_HH__
 
 #include <regex>
+#include <array>
+#include <atomic>
 #include <memory>
+#include <vector>
+#include <set>
 
 #include "timer_return.hh"
 #include "timer_rule.hh"
+#include "timer_calendar.hh"
+#include "timer_zone.hh"
 
 #define TIMER_MAX_YEAR (3000)
 #define TIMER_MIN_YEAR (0)
@@ -34,9 +40,15 @@
 #define TIMER_MIN_SECOND (0)
 #define TIMER_SECOND_COUNT (TIMER_MAX_SECOND - TIMER_MIN_SECOND + 1)
 
+// Cache line of the next-fire memo, apart from the fields every search reads.
+#define TIMER_CRONTAB_MEMO_ALIGN (64)
+
 namespace xg::timer {
 
-class RuleCrontab : public Rule {
+struct CrontabField;
+struct CrontabFields;
+
+class RuleCrontab final : public Rule {
 private:
     class FieldRule {
     public:
@@ -47,37 +59,72 @@ private:
             Range,
             FrequencyRange,
             Value,
+            FrequencyValue,     // n/step
+            NoSpecific,         // ?
+            LastDay,            // L, L-n (day of month)
+            NearestWeekday,     // nW (day of month)
+            LastWeekday,        // LW (day of month)
+            NthDayOfWeek,       // d#n (day of week)
+            LastDayOfWeek,      // dL (day of week)
         };
     public:
-        FieldRule(std::string rule, int max, int min);
+        FieldRule(std::string rule, int max, int min, std::set<RuleType> extends = {});
+        /**
+        * @brief FieldRule - Field compiled ahead of time, see CrontabParser.
+        */
+        FieldRule(const CrontabField& field, int max, int min);
         FieldRule(FieldRule&& other);
         virtual ~FieldRule() { };
 
         void ParseRule();
         void ValidRule();
-        bool Valid();
-        void SetLastTime(Rule::RefTimePoint&& last_time);
-        bool CheckValue(int curr_value);
-        virtual std::tuple<Return, int> GetNextValue(int curr_value);
+        void CompileRule();
+        bool Valid() const;
+        bool IsAny() const;
+        bool CheckValue(int curr_value) const;
+        virtual std::tuple<Return, int> GetNextValue(int curr_value) const;
+        /**
+        * @brief GetMask - Compiled value mask, bit N set when value N matches.
+        */
+        const std::vector<uint64_t>& GetMask() const;
+        /**
+        * @brief HasSpecial - Field holds values only known per month (L, W, #).
+        */
+        bool HasSpecial() const;
         void Print();
+    protected:
+        int find_next_(int value) const;
+        static std::string replace_names_(std::string rule, const std::vector<std::string>& names, int first);
+        // Leading digits of text, INT_MAX when out of range or missing, never throws.
+        static int to_int_(const std::string& text);
     protected:
         bool _parsed;
         std::string _raw_rule;
-        Rule::RefTimePoint _last_time;
         int _field_max_value;
         int _field_min_value;
 
-        std::map<RuleType, std::string> _rule_map;
-        static std::map<RuleType, std::regex> RegexTable;
+        std::multimap<RuleType, std::string> _rule_map;
+        std::set<RuleType> _extend_types;
+        std::vector<uint64_t> _mask;
+        uint64_t _last_mask;        // L-n: bit n, dL: bit d
+        uint64_t _nearest_mask;     // nW: bit n
+        uint64_t _nth_mask;         // d#n: bit (d - 1) * 8 + n
+        bool _last_weekday;         // LW
+        bool _any;                  // * or ?
+        static const std::map<RuleType, std::regex> RegexTable;
+        static const std::map<RuleType, std::regex> ValueRegexTable;
+
+        friend class RuleCrontab;
     };
 
     class YearRule : public FieldRule {
     public:
         YearRule(std::string rule);
+        YearRule(const CrontabField& field);
         YearRule(YearRule&& other);
         ~YearRule();
 
-        std::tuple<Return, int> GetNextValue(int curr_value);
+        std::tuple<Return, int> GetNextValue(int curr_value) const;
     };
 
     class MonthRule : public FieldRule {
@@ -85,6 +132,8 @@ private:
         MonthRule(std::string rule);
         MonthRule(MonthRule&& other);
         ~MonthRule();
+
+        static const std::vector<std::string> Names;
     };
 
     class DayOfMonthRule : public FieldRule {
@@ -92,8 +141,6 @@ private:
         DayOfMonthRule(std::string rule);
         DayOfMonthRule(DayOfMonthRule&& other);
         ~DayOfMonthRule();
-
-        std::tuple<Return, int> GetNextValue(int curr_value);
     };
 
     class DayOfWeekRule : public FieldRule {
@@ -101,6 +148,8 @@ private:
         DayOfWeekRule(std::string rule);
         DayOfWeekRule(DayOfWeekRule&& other);
         ~DayOfWeekRule();
+
+        static const std::vector<std::string> Names;
     };
 
     class HourRule : public FieldRule {
@@ -139,36 +188,137 @@ public:
 public:
     RuleCrontab(std::string rule);
     RuleCrontab(RefTimePoint start_time, std::string rule);
+    /**
+    * @brief RuleCrontab - Rule matched on the local wall time of an IANA zone.
+    *
+    * @param [rule] - Crontab rule.
+    * @param [zone] - IANA zone name, e.g. "Asia/Shanghai".
+    */
+    RuleCrontab(std::string rule, std::string zone);
+    RuleCrontab(RefTimePoint start_time, std::string rule, std::string zone);
+    /**
+    * @brief RuleCrontab - Rule compiled ahead of time, see Crontab<"...">().
+    *
+    * @param [fields] - Compiled fields.
+    * @param [rule] - Rule text, for logs.
+    * @param [zone] - IANA zone name, empty for UTC.
+    */
+    RuleCrontab(const CrontabFields& fields, std::string rule, std::string zone = "");
     ~RuleCrontab();
 
     /**
     * @brief Valid - Inherited function(Rule).
+    *                Fire times are whole seconds, so the wheel tick has to
+    *                divide one second for them to fall on tick boundaries.
     */
-    bool Valid(WheelAccuracy& accuracy);
+    bool Valid(WheelAccuracy& accuracy) const;
     /**
-    * @brief Valid - Inherited function(Rule).
+    * @brief GetNextExprieScale - Inherited function(Rule).
+    *                             Ticks from reftime to the next fire, rounded
+    *                             up so the task never fires early.
     */
-    std::tuple<Return, WheelScale> GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy);
+    std::tuple<Return, WheelScale> GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy) const;
 
     /**
-    * @brief Valid - Inherited function(Rule).
+    * @brief GetNextExprieTime - Inherited function(Rule).
+    *                            The last searched window [reftime, next) is
+    *                            kept, a query falling inside it is answered
+    *                            without a search.
+    */
+    std::tuple<Return, RefTimePoint> GetNextExprieTime(RefTimePoint&& reftime) const;
+    /**
+    * @brief GetNextExprieTime - First fire after the start time. Stateless,
+    *                            callers walk further fires by passing the
+    *                            previous fire time as reftime.
+    */
+    std::tuple<Return, RefTimePoint> GetNextExprieTime() const;
+    /**
+    * @brief GetStartTime - Reference time given on construction.
+    */
+    const RefTimePoint& GetStartTime() const;
+
+    /**
+    * @brief GetZone - Zone the rule is matched in, null for UTC.
     */
-    std::tuple<Return, RefTimePoint> GetNextExprieTime(RefTimePoint&& reftime);
-    std::tuple<Return, RefTimePoint> GetNextExprieTime();
+    const std::shared_ptr<const Zone>& GetZone() const;
+
+    /**
+    * @brief IsWallClock - Inherited function(Rule).
+    */
+    bool IsWallClock() const { return true; }
+
+    /**
+    * @brief Parsed - Whether every field of the rule was parsed.
+    */
+    bool Parsed() const;
+    /**
+    * @brief GetFieldMask - Compiled value mask of a field.
+    *
+    * @param [field] - Rule field.
+    *
+    * @returns  Mask words, bit N set when value N of the field matches.
+    */
+    const std::vector<uint64_t>& GetFieldMask(Field field) const;
+    /**
+    * @brief IsDayUnion - Both day fields are restricted, a day matches when either does.
+    */
+    bool IsDayUnion() const;
+    /**
+    * @brief HasDaySpecial - Day fields use L, W or #, days must be resolved per month.
+    */
+    bool HasDaySpecial() const;
+    /**
+    * @brief GetDayMask - Days of the calendar's month the rule fires on.
+    *
+    * @param [calendar] - Any time within the month.
+    *
+    * @returns  Mask, bit N set when day N of the month matches both day fields.
+    */
+    uint64_t GetDayMask(const Calendar& calendar) const;
 
     static int GetMonthMaxDays(int year, int month);
+    /**
+    * @brief Normalize - Canonical rule text, fields upper cased and joined
+    *                    by single spaces. Rules with equal text compile equal.
+    *
+    * @param [rule] - Crontab rule.
+    *
+    * @returns  Normalized rule text.
+    */
+    static std::string Normalize(const std::string& rule);
 private:
     bool _parsed;
     std::string _raw_rule;
     RefTimePoint _start_time;
-    RefTimePoint _last_time;
+    std::shared_ptr<const Zone> _zone;
     std::map<int, FieldRule*> _crontab_rule;
+    std::array<FieldRule*, Field::End + 1> _fields;     // _crontab_rule by index, for the search
+    bool _day_union;
+    uint64_t _weekday_days[TIMER_DAYOFWEEK_COUNT];      // plain weekday days, by first weekday of month
+    int _last_year;             // last year the rule can fire in, -1 for never
+    uint64_t _reach_months;     // months holding a matching day in some year
+
+    // Last searched window [from, next) in ns, no fire inside it. Seqlock,
+    // odd while written, readers never block and fall back to a search.
+    // On its own cache line, a store does not evict the rule's fields from
+    // the other threads evaluating it.
+    struct alignas(TIMER_CRONTAB_MEMO_ALIGN) Memo {
+        std::atomic<unsigned> seq{0};
+        std::atomic<long long> from{0};
+        std::atomic<long long> next{0};
+    };
+    mutable Memo _memo;
 private:
     void parse_rule_();
+    void load_rule_(const CrontabFields& fields);
+    void finish_rule_();
+    void compile_reach_();
     FieldRule* parse_field_rule_(int field, std::string rule);
-    int get_field_value_(RefTimePoint&& time, Field&& field);
-    void set_field_value_(RefTimePoint&& time, Field&& field, int value);
-    Return gen_next_time_(RefTimePoint& next_time, Field&& field);
+    int get_field_value_(const Calendar& calendar, Field field) const;
+    Return gen_next_time_(Calendar& calendar) const;
+    std::tuple<Return, RefTimePoint> get_next_zone_time_(const RefTimePoint& reftime) const;
+    bool memo_find_(const RefTimePoint& reftime, RefTimePoint& next) const;
+    void memo_store_(const RefTimePoint& reftime, const RefTimePoint& next) const;
 };
 
 }
@@ -0,0 +1,263 @@
+#include <cstring>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "timer_log.hh"
+#include "timer_rule_crontab_batch.hh"
+
+namespace xg::timer {
+
+namespace {
+
+enum KernelRow : int {
+    KernelSecond = 0,
+    KernelMinute,
+    KernelHour,
+    KernelDayOfMonth,
+    KernelMonth,
+    KernelDayOfWeek,
+    KernelDayUnion,
+    KernelYear,
+    KernelRowCount,
+};
+
+using MatchKernel = void (*)(uint64_t* result, const uint64_t* const* rows, size_t words);
+
+inline uint64_t match_word(const uint64_t* const* rows, size_t index)
+{
+    uint64_t monthday = rows[KernelDayOfMonth][index];
+    uint64_t weekday = rows[KernelDayOfWeek][index];
+    uint64_t day = (monthday & weekday) | (rows[KernelDayUnion][index] & (monthday | weekday));
+    return rows[KernelSecond][index] & rows[KernelMinute][index] & rows[KernelHour][index]
+            & rows[KernelMonth][index] & rows[KernelYear][index] & day;
+}
+
+void match_scalar(uint64_t* result, const uint64_t* const* rows, size_t words)
+{
+    for (size_t index = 0; index < words; ++index) {
+        result[index] = match_word(rows, index);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+inline __m128i load_sse2(const uint64_t* row, size_t index)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + index));
+}
+
+__attribute__((target("sse2")))
+void match_sse2(uint64_t* result, const uint64_t* const* rows, size_t words)
+{
+    for (size_t index = 0; index < words; index += 2) {
+        __m128i monthday = load_sse2(rows[KernelDayOfMonth], index);
+        __m128i weekday = load_sse2(rows[KernelDayOfWeek], index);
+        __m128i day = _mm_or_si128(_mm_and_si128(monthday, weekday),
+                                   _mm_and_si128(load_sse2(rows[KernelDayUnion], index), _mm_or_si128(monthday, weekday)));
+        __m128i match = _mm_and_si128(_mm_and_si128(load_sse2(rows[KernelSecond], index), load_sse2(rows[KernelMinute], index)),
+                                      _mm_and_si128(load_sse2(rows[KernelHour], index), load_sse2(rows[KernelMonth], index)));
+        match = _mm_and_si128(match, _mm_and_si128(load_sse2(rows[KernelYear], index), day));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + index), match);
+    }
+}
+
+__attribute__((target("avx2")))
+inline __m256i load_avx2(const uint64_t* row, size_t index)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + index));
+}
+
+__attribute__((target("avx2")))
+void match_avx2(uint64_t* result, const uint64_t* const* rows, size_t words)
+{
+    for (size_t index = 0; index < words; index += 4) {
+        __m256i monthday = load_avx2(rows[KernelDayOfMonth], index);
+        __m256i weekday = load_avx2(rows[KernelDayOfWeek], index);
+        __m256i day = _mm256_or_si256(_mm256_and_si256(monthday, weekday),
+                                      _mm256_and_si256(load_avx2(rows[KernelDayUnion], index), _mm256_or_si256(monthday, weekday)));
+        __m256i match = _mm256_and_si256(_mm256_and_si256(load_avx2(rows[KernelSecond], index), load_avx2(rows[KernelMinute], index)),
+                                         _mm256_and_si256(load_avx2(rows[KernelHour], index), load_avx2(rows[KernelMonth], index)));
+        match = _mm256_and_si256(match, _mm256_and_si256(load_avx2(rows[KernelYear], index), day));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(result + index), match);
+    }
+}
+#endif
+
+MatchKernel select_kernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return match_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return match_sse2;
+    }
+#endif
+    return match_scalar;
+}
+
+const MatchKernel Kernel = select_kernel();
+
+inline bool mask_test(const std::vector<uint64_t>& mask, int value)
+{
+    return (value >= 0 && (size_t)(value >> 6) < mask.size() && ((mask[value >> 6] >> (value & 63)) & 1));
+}
+
+// Row words are kept a multiple of one AVX2 vector.
+constexpr size_t RowWordsAlign = 4;
+
+}
+
+RuleCrontabBatch::RuleCrontabBatch() : _words(0), _year(-1), _month(-1) { }
+
+RuleCrontabBatch::~RuleCrontabBatch() { }
+
+size_t RuleCrontabBatch::Size() const
+{
+    return _rules.size();
+}
+
+void RuleCrontabBatch::set_bit_(int row, size_t index, bool value)
+{
+    uint64_t& word = row_(row)[index / 64];
+    if (value) {
+        word |= (1ULL << (index % 64));
+    } else {
+        word &= ~(1ULL << (index % 64));
+    }
+}
+
+void RuleCrontabBatch::grow_()
+{
+    size_t words = _words ? _words * 2 : RowWordsAlign;
+    std::vector<uint64_t> rows((size_t)RowCount * words, 0);
+    for (int row = 0; row < RowCount; ++row) {
+        if (_words) {
+            std::memcpy(&rows[(size_t)row * words], row_(row), _words * sizeof(uint64_t));
+        }
+    }
+    _rows.swap(rows);
+    _words = words;
+    _result.assign(_words, 0);
+}
+
+void RuleCrontabBatch::load_rule_(size_t index)
+{
+    const RuleCrontab* rule = _rules[index];
+    auto load_field = [&](int row, RuleCrontab::Field field, int min, int max) {
+        const std::vector<uint64_t>& mask = rule->GetFieldMask(field);
+        for (int value = min; value <= max; ++value) {
+            set_bit_(row + value - min, index, mask_test(mask, value));
+        }
+    };
+    load_field(SecondRow, RuleCrontab::Field::Second, TIMER_MIN_SECOND, TIMER_MAX_SECOND);
+    load_field(MinuteRow, RuleCrontab::Field::Minute, TIMER_MIN_MINUTE, TIMER_MAX_MINUTE);
+    load_field(HourRow, RuleCrontab::Field::Hour, TIMER_MIN_HOUR, TIMER_MAX_HOUR);
+    load_field(DayOfMonthRow, RuleCrontab::Field::DayOfMonth, TIMER_MIN_DAYOFMONTH, TIMER_MAX_DAYOFMONTH);
+    load_field(MonthRow, RuleCrontab::Field::Month, TIMER_MIN_MONTH, TIMER_MAX_MONTH);
+    load_field(DayOfWeekRow, RuleCrontab::Field::DayOfWeek, TIMER_MIN_DAYOFWEEK, TIMER_MAX_DAYOFWEEK);
+    set_bit_(DayUnionRow, index, rule->IsDayUnion());
+    set_bit_(YearRow, index, mask_test(rule->GetFieldMask(RuleCrontab::Field::Year), _year));
+}
+
+void RuleCrontabBatch::load_days_(const Calendar& calendar)
+{
+    // Resolved day mask already combines day of month and day of week.
+    for (size_t index : _special) {
+        uint64_t days = _rules[index]->GetDayMask(calendar);
+        for (int value = TIMER_MIN_DAYOFMONTH; value <= TIMER_MAX_DAYOFMONTH; ++value) {
+            set_bit_(DayOfMonthRow + value - TIMER_MIN_DAYOFMONTH, index, (days >> value) & 1);
+        }
+        for (int value = TIMER_MIN_DAYOFWEEK; value <= TIMER_MAX_DAYOFWEEK; ++value) {
+            set_bit_(DayOfWeekRow + value - TIMER_MIN_DAYOFWEEK, index, true);
+        }
+        set_bit_(DayUnionRow, index, false);
+    }
+}
+
+void RuleCrontabBatch::load_year_()
+{
+    for (size_t index = 0; index < _rules.size(); ++index) {
+        if (_rules[index]) {
+            set_bit_(YearRow, index, mask_test(_rules[index]->GetFieldMask(RuleCrontab::Field::Year), _year));
+        }
+    }
+}
+
+std::tuple<Return, size_t> RuleCrontabBatch::Add(const RuleCrontab& rule)
+{
+    // Matched on a UTC calendar, a zoned rule would fire at the wrong hour.
+    if (!rule.Parsed() || rule.GetZone()) {
+        return {Return::ESCHEDULE_RULE_INVALID, 0};
+    }
+    size_t index;
+    if (!_free.empty()) {
+        index = _free.back();
+        _free.pop_back();
+        _rules[index] = &rule;
+    } else {
+        index = _rules.size();
+        _rules.push_back(&rule);
+        if (index >= _words * 64) {
+            grow_();
+        }
+    }
+    load_rule_(index);
+    if (rule.HasDaySpecial()) {
+        _special.push_back(index);
+        _month = -1;
+    }
+    return {Return::SUCCESS, index};
+}
+
+Return RuleCrontabBatch::Remove(size_t index)
+{
+    if (index >= _rules.size() || !_rules[index]) {
+        return Return::ERROR;
+    }
+    for (int row = 0; row < RowCount; ++row) {
+        set_bit_(row, index, false);
+    }
+    _rules[index] = nullptr;
+    _free.push_back(index);
+    _special.erase(std::remove(_special.begin(), _special.end(), index), _special.end());
+    return Return::SUCCESS;
+}
+
+const std::vector<uint64_t>& RuleCrontabBatch::Match(Rule::RefTimePoint&& time)
+{
+    return Match(Calendar(time));
+}
+
+const std::vector<uint64_t>& RuleCrontabBatch::Match(const Calendar& calendar)
+{
+    if (!_words) {
+        return _result;
+    }
+    // Year rows only change once a year, refresh lazily.
+    if (calendar.GetYear() != _year) {
+        _year = calendar.GetYear();
+        load_year_();
+    }
+    if (calendar.GetYear() * 12 + calendar.GetMonth() != _month) {
+        _month = calendar.GetYear() * 12 + calendar.GetMonth();
+        load_days_(calendar);
+    }
+    const uint64_t* rows[KernelRowCount] = {
+        row_(SecondRow + calendar.GetSecond() - TIMER_MIN_SECOND),
+        row_(MinuteRow + calendar.GetMinute() - TIMER_MIN_MINUTE),
+        row_(HourRow + calendar.GetHour() - TIMER_MIN_HOUR),
+        row_(DayOfMonthRow + calendar.GetDayOfMonth() - TIMER_MIN_DAYOFMONTH),
+        row_(MonthRow + calendar.GetMonth() - TIMER_MIN_MONTH),
+        row_(DayOfWeekRow + calendar.GetDayOfWeek() - TIMER_MIN_DAYOFWEEK),
+        row_(DayUnionRow),
+        row_(YearRow),
+    };
+    Kernel(_result.data(), rows, _words);
+    return _result;
+}
+
+}
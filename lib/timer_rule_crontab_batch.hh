@@ -0,0 +1,109 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-09 14:31
+ * @file     : timer_rule_crontab_batch.hh
+ * @brief    : Evaluate many crontab rules against one time at once.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_RULE_CRONTAB_BATCH_HH__
+#define __TIMER_RULE_CRONTAB_BATCH_HH__
+
+#include <vector>
+
+#include "timer_return.hh"
+#include "timer_calendar.hh"
+#include "timer_rule_crontab.hh"
+
+namespace xg::timer {
+
+/**
+* @brief - Batch matcher for compiled crontab rules.
+*          Field masks are stored transposed (structure of arrays): every
+*          value of every field owns a bit row and bit N of a row belongs
+*          to rule N. Matching one time is a handful of row ANDs, done 256
+*          rules at a time with AVX2 (SSE2 or scalar as fallback).
+*          Rules with month dependent days (L, W, #) get their day rows
+*          resolved again whenever the matched month changes.
+*          Rules are referenced, not copied, and must outlive the batch.
+*          Times are matched as UTC, rules with a zone are not accepted.
+*/
+class RuleCrontabBatch {
+public:
+    RuleCrontabBatch();
+    ~RuleCrontabBatch();
+
+    /**
+    * @brief Add - Add a rule to the batch.
+    *
+    * @param [rule] - Parsed crontab rule without a zone.
+    *
+    * @returns  Tuple of Return class & rule index in the result bitmap,
+    *           ESCHEDULE_RULE_INVALID for an unparsed or zoned rule.
+    */
+    std::tuple<Return, size_t> Add(const RuleCrontab& rule);
+
+    /**
+    * @brief Remove - Remove a rule, its index may be reused by a later Add.
+    *
+    * @param [index] - Rule index returned by Add.
+    *
+    * @returns  Return class.
+    */
+    Return Remove(size_t index);
+
+    /**
+    * @brief Size - Number of rule indexes in use or reserved.
+    */
+    size_t Size() const;
+
+    /**
+    * @brief Match - Find all rules firing at the given time.
+    *
+    * @param [time] - Time to test, seconds resolution.
+    *
+    * @returns  Bitmap, bit N set when rule N fires. Valid until next call.
+    */
+    const std::vector<uint64_t>& Match(Rule::RefTimePoint&& time);
+    const std::vector<uint64_t>& Match(const Calendar& calendar);
+
+    static bool Test(const std::vector<uint64_t>& bitmap, size_t index) {
+        return (index / 64 < bitmap.size()) && ((bitmap[index / 64] >> (index % 64)) & 1);
+    }
+
+private:
+    enum Row : int {
+        SecondRow = 0,
+        MinuteRow = SecondRow + TIMER_SECOND_COUNT,
+        HourRow = MinuteRow + TIMER_MINUTE_COUNT,
+        DayOfMonthRow = HourRow + TIMER_HOUR_COUNT,
+        MonthRow = DayOfMonthRow + TIMER_DAYOFMONTH_COUNT,
+        DayOfWeekRow = MonthRow + TIMER_MONTH_COUNT,
+        DayUnionRow = DayOfWeekRow + TIMER_DAYOFWEEK_COUNT,
+        YearRow,
+        RowCount,
+    };
+
+    uint64_t* row_(int row) { return &_rows[(size_t)row * _words]; }
+    void set_bit_(int row, size_t index, bool value);
+    void grow_();
+    void load_rule_(size_t index);
+    void load_year_();
+    void load_days_(const Calendar& calendar);
+
+private:
+    size_t _words;
+    int _year;
+    int _month;
+    std::vector<uint64_t> _rows;
+    std::vector<uint64_t> _result;
+    std::vector<const RuleCrontab*> _rules;
+    std::vector<size_t> _free;
+    std::vector<size_t> _special;
+};
+
+}
+
+#endif
@@ -0,0 +1,311 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-26 14:40
+ * @file     : timer_rule_crontab_literal.hh
+ * @brief    : Crontab rules parsed at compile time.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_RULE_CRONTAB_LITERAL_HH__
+#define __TIMER_RULE_CRONTAB_LITERAL_HH__
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "timer_rule_crontab.hh"
+
+// Mask words of the widest field (year).
+#define TIMER_CRONTAB_MASK_WORDS (TIMER_MAX_YEAR / 64 + 1)
+// Largest number accepted in a literal, above every field maximum.
+#define TIMER_CRONTAB_MAX_NUMBER (100000)
+
+namespace xg::timer {
+
+/**
+* @brief - One compiled crontab field, same layout as RuleCrontab's
+*          runtime compiled field rule.
+*/
+struct CrontabField {
+    uint64_t mask[TIMER_CRONTAB_MASK_WORDS];
+    uint64_t last_mask;         // L-n: bit n, dL: bit d
+    uint64_t nearest_mask;      // nW: bit n
+    uint64_t nth_mask;          // d#n: bit (d - 1) * 8 + n
+    bool last_weekday;          // LW
+    bool any;                   // * or ?
+};
+
+/**
+* @brief - Compiled crontab rule, fields in RuleCrontab::Field order.
+*/
+struct CrontabFields {
+    CrontabField field[RuleCrontab::Field::End + 1];
+};
+
+/**
+* @brief - Crontab rule text usable as a template argument.
+*/
+template<size_t N>
+struct CrontabText {
+    consteval CrontabText(const char (&text)[N]) {
+        for (size_t index = 0; index < N; ++index) {
+            _text[index] = text[index];
+        }
+    }
+    constexpr std::string_view View() const {
+        return std::string_view(_text, N - 1);
+    }
+
+    char _text[N];
+};
+
+/**
+* @brief - Compile time crontab parser, accepts the same syntax as the
+*          RuleCrontab constructor and compiles the same masks. A bad rule
+*          fails the constant evaluation, the throw in the error names the
+*          reason.
+*/
+class CrontabParser {
+public:
+    static consteval CrontabFields Parse(std::string_view text) {
+        CrontabFields fields = {};
+        int field = RuleCrontab::Field::Begin;
+        size_t pos = 0;
+        while (true) {
+            while (pos < text.size() && text[pos] == ' ') {
+                ++pos;
+            }
+            if (pos >= text.size()) {
+                break;
+            }
+            size_t end = text.find(' ', pos);
+            if (end == std::string_view::npos) {
+                end = text.size();
+            }
+            if (field > RuleCrontab::Field::End) {
+                throw "crontab rule has too many fields";
+            }
+            fields.field[field] = parse_field_(field, text.substr(pos, end - pos));
+            ++field;
+            pos = end;
+        }
+        if (field <= RuleCrontab::Field::End) {
+            throw "crontab rule has too few fields";
+        }
+        return fields;
+    }
+
+private:
+    struct Cursor {
+        std::string_view text;
+        size_t pos;
+
+        constexpr bool End() const { return pos >= text.size(); }
+        constexpr char Peek() const { return End() ? '\0' : upper_(text[pos]); }
+        constexpr bool Eat(char c) {
+            if (Peek() != c) {
+                return false;
+            }
+            ++pos;
+            return true;
+        }
+    };
+
+    static constexpr char upper_(char c) {
+        return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+    }
+
+    static consteval int min_(int field) {
+        constexpr int mins[] = { TIMER_MIN_YEAR, TIMER_MIN_MONTH, TIMER_MIN_DAYOFMONTH, TIMER_MIN_DAYOFWEEK,
+                                 TIMER_MIN_HOUR, TIMER_MIN_MINUTE, TIMER_MIN_SECOND };
+        return mins[field];
+    }
+    static consteval int max_(int field) {
+        constexpr int maxs[] = { TIMER_MAX_YEAR, TIMER_MAX_MONTH, TIMER_MAX_DAYOFMONTH, TIMER_MAX_DAYOFWEEK,
+                                 TIMER_MAX_HOUR, TIMER_MAX_MINUTE, TIMER_MAX_SECOND };
+        return maxs[field];
+    }
+
+    // Number, or a month / weekday name in those fields.
+    static consteval bool number_(int field, Cursor& cursor, int& value) {
+        constexpr std::string_view months[] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+                                                "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
+        constexpr std::string_view weekdays[] = { "MON", "TUE", "WED", "THU", "FRI", "SAT", "SUN" };
+        auto name = [&](const std::string_view* names, int count, int first) {
+            for (int index = 0; index < count; ++index) {
+                if (cursor.pos + 3 > cursor.text.size()) {
+                    return false;
+                }
+                bool match = true;
+                for (size_t at = 0; at < 3; ++at) {
+                    match = match && (upper_(cursor.text[cursor.pos + at]) == names[index][at]);
+                }
+                if (match) {
+                    cursor.pos += 3;
+                    value = first + index;
+                    return true;
+                }
+            }
+            return false;
+        };
+        if (field == RuleCrontab::Field::Month && name(months, 12, TIMER_MIN_MONTH)) {
+            return true;
+        }
+        if (field == RuleCrontab::Field::DayOfWeek && name(weekdays, 7, TIMER_MIN_DAYOFWEEK)) {
+            return true;
+        }
+        if (cursor.Peek() < '0' || cursor.Peek() > '9') {
+            return false;
+        }
+        value = 0;
+        while (cursor.Peek() >= '0' && cursor.Peek() <= '9') {
+            value = value * 10 + (cursor.Peek() - '0');
+            if (value > TIMER_CRONTAB_MAX_NUMBER) {
+                throw "crontab value too large";
+            }
+            ++cursor.pos;
+        }
+        return true;
+    }
+
+    static consteval void set_(CrontabField& out, int begin, int end, int step) {
+        for (int value = begin; value <= end; value += step) {
+            out.mask[value >> 6] |= (1ULL << (value & 63));
+        }
+    }
+
+    static consteval void parse_item_(int field, std::string_view item, CrontabField& out) {
+        const int min = min_(field);
+        const int max = max_(field);
+        const bool day_of_month = (field == RuleCrontab::Field::DayOfMonth);
+        const bool day_of_week = (field == RuleCrontab::Field::DayOfWeek);
+        Cursor cursor = { item, 0 };
+        int value = 0;
+        int end = 0;
+        int step = 0;
+
+        if (cursor.Eat('*')) {
+            step = 1;
+            if (cursor.Eat('/')) {
+                if (!number_(field, cursor, step)) {
+                    throw "crontab frequency missing";
+                }
+                if (step == 0) {
+                    throw "crontab frequency is zero";
+                }
+            } else {
+                out.any = true;
+            }
+            set_(out, min, max, step);
+        } else if (cursor.Eat('?')) {
+            if (!day_of_month && !day_of_week) {
+                throw "crontab ? only allowed in day fields";
+            }
+            out.any = true;
+            set_(out, min, max, 1);
+        } else if (day_of_month && cursor.Eat('L')) {
+            if (cursor.Eat('W')) {
+                out.last_weekday = true;
+            } else if (cursor.Eat('-')) {
+                if (!number_(field, cursor, value) || value >= TIMER_MAX_DAYOFMONTH) {
+                    throw "crontab last day offset invalid";
+                }
+                out.last_mask |= (1ULL << value);
+            } else {
+                out.last_mask |= 1ULL;
+            }
+        } else if (number_(field, cursor, value)) {
+            if (cursor.Eat('-')) {
+                if (!number_(field, cursor, end)) {
+                    throw "crontab range end missing";
+                }
+                if (value >= end || value < min || value > max || end < min || end > max) {
+                    throw "crontab range invalid";
+                }
+                step = 1;
+                if (cursor.Eat('/')) {
+                    if (!number_(field, cursor, step) || step == 0 || step > end - value) {
+                        throw "crontab range frequency invalid";
+                    }
+                }
+                set_(out, value, end, step);
+            } else if (cursor.Eat('/')) {
+                if (value < min || value > max) {
+                    throw "crontab value out of range";
+                }
+                if (!number_(field, cursor, step) || step == 0 || step > max - value) {
+                    throw "crontab frequency invalid";
+                }
+                set_(out, value, max, step);
+            } else if (day_of_month && cursor.Eat('W')) {
+                if (value < TIMER_MIN_DAYOFMONTH || value > TIMER_MAX_DAYOFMONTH) {
+                    throw "crontab nearest weekday invalid";
+                }
+                out.nearest_mask |= (1ULL << value);
+            } else if (day_of_week && cursor.Eat('#')) {
+                if (!number_(field, cursor, end) || end < 1 || end > 5) {
+                    throw "crontab week index invalid";
+                }
+                if (value < TIMER_MIN_DAYOFWEEK || value > TIMER_MAX_DAYOFWEEK) {
+                    throw "crontab weekday invalid";
+                }
+                out.nth_mask |= (1ULL << ((value - 1) * 8 + end));
+            } else if (day_of_week && cursor.Eat('L')) {
+                if (value < TIMER_MIN_DAYOFWEEK || value > TIMER_MAX_DAYOFWEEK) {
+                    throw "crontab weekday invalid";
+                }
+                out.last_mask |= (1ULL << value);
+            } else {
+                if (value < min || value > max) {
+                    throw "crontab value out of range";
+                }
+                set_(out, value, value, 1);
+            }
+        } else {
+            throw "crontab syntax error";
+        }
+        if (!cursor.End()) {
+            throw "crontab syntax error";
+        }
+    }
+
+    static consteval CrontabField parse_field_(int field, std::string_view text) {
+        CrontabField out = {};
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find(',', pos);
+            if (end == std::string_view::npos) {
+                end = text.size();
+            }
+            if (end > pos) {
+                parse_item_(field, text.substr(pos, end - pos), out);
+            }
+            pos = end + 1;
+        }
+        return out;
+    }
+};
+
+/**
+* @brief Crontab - Rule from a literal parsed at compile time, only the
+*                  compiled masks are loaded at runtime.
+*                  e.g. auto rule = Crontab<"* * ? MON-FRI 9 30 0">();
+*
+* @param [zone] - IANA zone name, empty for UTC.
+*
+* @returns  Shared compiled rule.
+*/
+template<CrontabText Text>
+std::shared_ptr<RuleCrontab> Crontab(std::string zone = "")
+{
+    static constexpr CrontabFields fields = CrontabParser::Parse(Text.View());
+    return std::make_shared<RuleCrontab>(fields, std::string(Text.View()), zone);
+}
+
+}
+
+#endif
@@ -47,7 +47,7 @@ RuleDuration::RuleDuration(std::chrono::years&& year)
 
 RuleDuration::~RuleDuration() { }
 
-bool RuleDuration::Valid(WheelAccuracy& accuracy)
+bool RuleDuration::Valid(WheelAccuracy& accuracy) const
 {
     if (!accuracy.Valid()) {
         return false;
@@ -62,7 +62,7 @@ bool RuleDuration::Valid(WheelAccuracy& accuracy)
 }
 
 std::tuple<Return, WheelScale>
-RuleDuration::GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy)
+RuleDuration::GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy) const
 {
     std::ignore = reftime;
     if (!Valid(accuracy)) {
@@ -71,10 +71,4 @@ RuleDuration::GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy
     return std::make_tuple(Return(Return::SUCCESS), WheelScale(_duration_nano.count() / accuracy.GetAccuracy().count()));
 }
 
-std::tuple<Return, RuleDuration::RefTimePoint>
-RuleDuration::GetNextExprieTime(RefTimePoint&& reftime)
-{
-    return {Return::SUCCESS, (reftime + _duration_nano)};
-}
-
 }
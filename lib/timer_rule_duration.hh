@@ -18,8 +18,9 @@ namespace xg::timer {
 
 /**
 * @brief - Scheduling rules based on time duration.
+*          Final and copyable, a task keeps it by value, see TaskRule.
 */
-class RuleDuration : public Rule {
+class RuleDuration final : public Rule {
 public:
     RuleDuration(std::chrono::nanoseconds&& nano);
     RuleDuration(std::chrono::microseconds&& micro);
@@ -36,16 +37,18 @@ public:
     /**
     * @brief Valid - Inherited function(Rule).
     */
-    bool Valid(WheelAccuracy& accuracy);
+    bool Valid(WheelAccuracy& accuracy) const;
     /**
     * @brief Valid - Inherited function(Rule).
     */
-    std::tuple<Return, WheelScale> GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy);
+    std::tuple<Return, WheelScale> GetNextExprieScale(RefTimePoint&& reftime, WheelAccuracy& accuracy) const;
 
     /**
     * @brief Valid - Inherited function(Rule).
     */
-    std::tuple<Return, RefTimePoint> GetNextExprieTime(RefTimePoint&& reftime);
+    std::tuple<Return, RefTimePoint> GetNextExprieTime(RefTimePoint&& reftime) const {
+        return {Return::SUCCESS, (reftime + _duration_nano)};
+    }
 
 private:
     std::chrono::nanoseconds _duration_nano;
@@ -0,0 +1,17 @@
+#include "timer_task.hh"
+
+namespace xg::timer {
+
+Task::Task(TaskRule&& rule, Callback&& callback, bool repeat, std::chrono::nanoseconds slack)
+        : _rule(std::move(rule)), _callback(std::move(callback)), _fired(false), _repeat(repeat), _wall(_rule.IsWallClock()), _preset(false),
+          _slack(slack), _state(TaskState::Pending), _touched(0), _expire(0), _prev(nullptr), _next(nullptr), _child(nullptr), _slot(nullptr),
+          _group_prev(nullptr), _group_next(nullptr), _wall_prev(nullptr), _wall_next(nullptr), _cancel_next(nullptr), _worker(nullptr) { }
+
+Task::Task(const Clock::TimePoint& deadline)
+        : _fired(false), _repeat(false), _wall(false), _preset(false), _slack(0), _state(TaskState::Pending), _touched(0), _deadline(deadline), _expire(0),
+          _prev(nullptr), _next(nullptr), _child(nullptr), _slot(nullptr), _group_prev(nullptr),
+          _group_next(nullptr), _wall_prev(nullptr), _wall_next(nullptr), _cancel_next(nullptr), _worker(nullptr) { }
+
+Task::~Task() { }
+
+}
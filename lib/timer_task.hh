@@ -1,12 +1,158 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-16 14:02
+ * @file     : timer_task.hh
+ * @brief    : Scheduled task living in a timer wheel.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
 #ifndef __TIMER_TASK_HH__
 #define __TIMER_TASK_HH__
 
+#include <memory>
+#include <atomic>
+#include <coroutine>
+
+#include "timer_rule.hh"
+#include "timer_task_rule.hh"
+#include "timer_clock.hh"
+#include "timer_function.hh"
+#include "timer_group.hh"
+
 namespace xg::timer {
 
+class Wheel;
+class WheelWorker;
+
+/**
+* @brief - Task life cycle, moved by CAS only.
+*          Pending -> Firing -> Pending (repeat) or Done, any of Pending and
+*          Firing -> Cancelled. A fire needs Pending -> Firing, so a callback
+*          runs at most once per fire and never after a cancel took effect.
+*/
+enum class TaskState : int {
+    Pending,
+    Firing,
+    Cancelled,
+    Done,
+};
+
+/**
+* @brief - Scheduled task.
+*          A task is owned by one wheel worker while scheduled and linked
+*          into a wheel slot list in place, the wheel never allocates.
+*          A task either runs a callback or resumes a suspended coroutine.
+*          The callback and the rule are stored inline, see TaskPool for the
+*          task itself.
+*/
 class Task {
-    
+public:
+    using Callback = UniqueFunction<void()>;
+
+public:
+    Task(TaskRule&& rule, Callback&& callback, bool repeat,
+         std::chrono::nanoseconds slack = std::chrono::nanoseconds(0));
+    /**
+    * @brief - One shot task firing at a fixed wheel time, without rule.
+    */
+    Task(const Clock::TimePoint& deadline);
+    ~Task();
+
+    /**
+    * @brief Cancelled - Whether the task was cancelled.
+    */
+    bool Cancelled() const {
+        return GetState() == TaskState::Cancelled || (_group && _group->Cancelled());
+    }
+
+    TaskState GetState() const {
+        return _state.load(std::memory_order_acquire);
+    }
+
+    /**
+    * @brief GetDeadline - Wheel time of the next fire, valid while scheduled.
+    */
+    const Clock::TimePoint& GetDeadline() const {
+        return _deadline;
+    }
+
+    const TaskRule& GetRule() const {
+        return _rule;
+    }
+
+    const std::shared_ptr<TimerGroup>& GetGroup() const {
+        return _group;
+    }
+
+    /**
+    * @brief GetSlack - Tolerance after the deadline, the task fires within
+    *                   [deadline, deadline + slack].
+    */
+    const std::chrono::nanoseconds& GetSlack() const {
+        return _slack;
+    }
+
+private:
+    friend class Wheel;
+    friend class WheelWorker;
+    friend class WheelManager;
+    friend class TimerAwaiter;
+
+    bool transit_(TaskState from, TaskState to) {
+        return _state.compare_exchange_strong(from, to, std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+    /**
+    * @brief cancel_ - Pending or Firing -> Cancelled.
+    *
+    * @returns  True for the one caller that cancelled the task.
+    */
+    bool cancel_() {
+        TaskState state = _state.load(std::memory_order_acquire);
+        while (state == TaskState::Pending || state == TaskState::Firing) {
+            if (_state.compare_exchange_weak(state, TaskState::Cancelled, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    TaskRule _rule;
+    Callback _callback;
+    std::coroutine_handle<> _handle;    // resumed instead of the callback
+    bool _fired;
+    bool _repeat;
+    bool _wall;                     // rule follows the wall clock
+    bool _preset;                   // _walltime holds the first fire, computed before Add
+    std::chrono::nanoseconds _slack;
+    std::atomic<TaskState> _state;
+    std::atomic<long long> _touched;    // deadline stored by Touch, wheel ns
+
+    Rule::RefTimePoint _reftime;    // wall time the deadline was computed from
+    Rule::RefTimePoint _walltime;   // wall time of the deadline
+    Clock::TimePoint _deadline;
+    long long _expire;              // deadline in wheel ticks
+
+    Task* _prev;
+    Task* _next;
+    Task* _child;                   // overflow heap only
+    Task** _slot;                   // head of the slot list, null when unlinked
+
+    std::shared_ptr<TimerGroup> _group;    // set before the task is added
+    Task* _group_prev;
+    Task* _group_next;
+
+    Task* _wall_prev;               // worker's wall clock task list
+    Task* _wall_next;
+
+    Task* _cancel_next;                     // worker's cancel stack
+    std::shared_ptr<Task> _cancel_ref;      // held while on the cancel stack
+
+    WheelWorker* _worker;
+    std::shared_ptr<Task> _self;    // keeps the task alive while scheduled
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
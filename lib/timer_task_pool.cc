@@ -0,0 +1,53 @@
+#include <new>
+#include <sys/mman.h>
+
+#include "timer_log.hh"
+#include "timer_numa.hh"
+#include "timer_task_pool.hh"
+
+namespace xg::timer {
+
+TaskPool::TaskPool() : _nodes(Numa::Instance().GetNodes()) { }
+
+void* TaskPool::Allocate(int index)
+{
+    Node& node = node_(index);
+    std::scoped_lock lock(node.mutex);
+    if (!node.free && !grow_(node, index)) {
+        throw std::bad_alloc();
+    }
+    Block* block = node.free;
+    node.free = block->next;
+    return block;
+}
+
+void TaskPool::Release(void* block, int index)
+{
+    Node& node = node_(index);
+    std::scoped_lock lock(node.mutex);
+    static_cast<Block*>(block)->next = node.free;
+    node.free = static_cast<Block*>(block);
+}
+
+bool TaskPool::grow_(Node& node, int index)
+{
+    size_t size = BLOCK * TIMER_TASK_POOL_CHUNK;
+    void* chunk = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (chunk == MAP_FAILED) {
+        TIMER_WHEEL_ERROR("Map task pool chunk failed");
+        return false;
+    }
+    // Before the free list below touches the pages.
+    if (Numa::Instance().Prefer(chunk, size, index) != Return::SUCCESS) {
+        TIMER_WHEEL_ERROR("Prefer node [", index, "] for task pool failed");
+    }
+    char* base = static_cast<char*>(chunk);
+    for (size_t offset = size; offset >= BLOCK; offset -= BLOCK) {
+        Block* block = reinterpret_cast<Block*>(base + offset - BLOCK);
+        block->next = node.free;
+        node.free = block;
+    }
+    return true;
+}
+
+}
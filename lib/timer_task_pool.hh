@@ -0,0 +1,129 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-24 10:15
+ * @file     : timer_task_pool.hh
+ * @brief    : Fixed block pool backing scheduled tasks.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_TASK_POOL_HH__
+#define __TIMER_TASK_POOL_HH__
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "timer_task.hh"
+
+// Blocks mapped at once when a node's free list runs dry.
+#define TIMER_TASK_POOL_CHUNK (256)
+// Block alignment, one task never shares a cache line with another.
+#define TIMER_TASK_POOL_ALIGN (64)
+// Room for the shared_ptr control block next to the task.
+#define TIMER_TASK_POOL_HEADROOM (64)
+
+namespace xg::timer {
+
+/**
+* @brief - Task pool, one free list of fixed size blocks per NUMA node.
+*          Make places the task and its shared_ptr control block in one
+*          block, so with an inline callback scheduling does no malloc.
+*          Chunks are mapped with a preference for their node and are never
+*          returned, tasks may outlive any manager.
+*/
+class TaskPool {
+public:
+    static constexpr size_t BLOCK = (sizeof(Task) + TIMER_TASK_POOL_HEADROOM + TIMER_TASK_POOL_ALIGN - 1)
+                                    / TIMER_TASK_POOL_ALIGN * TIMER_TASK_POOL_ALIGN;
+
+    /**
+    * @brief - Allocator for allocate_shared, bound to a node.
+    */
+    template<typename T>
+    class Allocator {
+    public:
+        using value_type = T;
+
+        explicit Allocator(int node) : _node(node) { }
+        template<typename U>
+        Allocator(const Allocator<U>& other) : _node(other.GetNode()) { }
+
+        T* allocate(size_t count) {
+            static_assert(sizeof(T) <= BLOCK && alignof(T) <= TIMER_TASK_POOL_ALIGN, "Task does not fit a pool block");
+            if (count != 1) {
+                return std::allocator<T>().allocate(count);
+            }
+            return static_cast<T*>(TaskPool::Instance().Allocate(_node));
+        }
+        void deallocate(T* block, size_t count) {
+            if (count != 1) {
+                std::allocator<T>().deallocate(block, count);
+                return;
+            }
+            TaskPool::Instance().Release(block, _node);
+        }
+
+        int GetNode() const {
+            return _node;
+        }
+
+        template<typename U>
+        bool operator==(const Allocator<U>& other) const {
+            return _node == other.GetNode();
+        }
+
+    private:
+        int _node;
+    };
+
+public:
+    static TaskPool& Instance() {
+        // Leaked on purpose, tasks held past exit are still released here.
+        static TaskPool* instance = new TaskPool();
+        return *instance;
+    }
+
+    /**
+    * @brief Make - Create a task in a pool block.
+    *
+    * @param [node] - NUMA node the block is taken from, the node of the
+    *                 worker the task is scheduled on.
+    * @param [args] - Task constructor arguments.
+    *
+    * @returns  Task handle.
+    */
+    template<typename... Args>
+    std::shared_ptr<Task> Make(int node, Args&&... args) {
+        return std::allocate_shared<Task>(Allocator<Task>(node), std::forward<Args>(args)...);
+    }
+
+    void* Allocate(int node);
+    void Release(void* block, int node);
+
+private:
+    struct Block {
+        Block* next;
+    };
+    struct alignas(TIMER_TASK_POOL_ALIGN) Node {
+        std::mutex mutex;
+        Block* free = nullptr;
+    };
+
+    TaskPool();
+    TaskPool(const TaskPool&);
+    TaskPool& operator=(const TaskPool&);
+
+    Node& node_(int node) {
+        return _nodes[(node < 0 || node >= (int)_nodes.size()) ? 0 : node];
+    }
+    bool grow_(Node& node, int index);
+
+private:
+    std::vector<Node> _nodes;
+};
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-25 10:10
+ * @file     : timer_task_rule.hh
+ * @brief    : Rule value held by a task, closed set of rule kinds.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_TASK_RULE_HH__
+#define __TIMER_TASK_RULE_HH__
+
+#include <memory>
+#include <variant>
+#include <type_traits>
+
+#include "timer_return.hh"
+#include "timer_rule.hh"
+#include "timer_rule_duration.hh"
+#include "timer_rule_crontab.hh"
+
+namespace xg::timer {
+
+/**
+* @brief - Scheduling rule of a task, stored inline in the task.
+*          Durations are kept by value, crontab rules by a shared reference
+*          to the compiled rule, which is const and shared by any number of
+*          tasks and workers. Both are dispatched without a virtual call,
+*          a duration re-arm inlines to one addition. Any other Rule
+*          subclass is kept as is and dispatched virtually.
+*          Converts from a RuleDuration value or a shared pointer to any
+*          rule, the concrete kind is picked once on construction.
+*/
+class TaskRule {
+public:
+    TaskRule() { }
+    TaskRule(std::nullptr_t) { }
+    TaskRule(const RuleDuration& duration) : _value(duration) { }
+
+    template<typename R, typename = std::enable_if_t<std::is_base_of_v<Rule, R>>>
+    TaskRule(std::shared_ptr<R> rule) {
+        using T = std::remove_const_t<R>;
+        if (!rule) {
+            return;
+        }
+        if constexpr (std::is_same_v<T, RuleDuration>) {
+            _value = *rule;
+        } else if constexpr (std::is_same_v<T, RuleCrontab>) {
+            _value = std::shared_ptr<const RuleCrontab>(std::move(rule));
+        } else if (auto duration = dynamic_cast<const RuleDuration*>(rule.get())) {
+            _value = *duration;
+        } else if (auto crontab = std::dynamic_pointer_cast<const RuleCrontab>(rule)) {
+            _value = std::move(crontab);
+        } else {
+            _value = std::shared_ptr<const Rule>(std::move(rule));
+        }
+    }
+
+    explicit operator bool() const {
+        return !std::holds_alternative<std::monostate>(_value);
+    }
+
+    /**
+    * @brief IsExtension - Custom Rule subclass, dispatched virtually.
+    */
+    bool IsExtension() const {
+        return std::holds_alternative<std::shared_ptr<const Rule>>(_value);
+    }
+
+    /**
+    * @brief Valid - See Rule::Valid, false for an empty rule.
+    */
+    bool Valid(WheelAccuracy& accuracy) const {
+        return visit_(false, [&](auto& rule) { return rule.Valid(accuracy); });
+    }
+
+    /**
+    * @brief GetNextExprieTime - See Rule::GetNextExprieTime.
+    */
+    std::tuple<Return, Rule::RefTimePoint> GetNextExprieTime(const Rule::RefTimePoint& reftime) const {
+        return visit_(std::tuple<Return, Rule::RefTimePoint>(Return::ESCHEDULE_RULE_INVALID, Rule::RefTimePoint()),
+                [&](auto& rule) { return rule.GetNextExprieTime(Rule::RefTimePoint(reftime)); });
+    }
+
+    /**
+    * @brief IsWallClock - See Rule::IsWallClock.
+    */
+    bool IsWallClock() const {
+        if (auto custom = std::get_if<std::shared_ptr<const Rule>>(&_value)) {
+            return (*custom)->IsWallClock();
+        }
+        return std::holds_alternative<std::shared_ptr<const RuleCrontab>>(_value);
+    }
+
+private:
+    // Calls func with the concrete rule, empty for no rule.
+    template<typename T, typename F>
+    T visit_(T empty, F&& func) const {
+        return std::visit([&](auto& value) -> T {
+            using V = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<V, std::monostate>) {
+                return empty;
+            } else if constexpr (std::is_same_v<V, RuleDuration>) {
+                return func(value);
+            } else {
+                return func(*value);
+            }
+        }, _value);
+    }
+
+private:
+    std::variant<std::monostate, RuleDuration, std::shared_ptr<const RuleCrontab>, std::shared_ptr<const Rule>> _value;
+};
+
+}
+
+#endif
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+#include "timer_wheel.hh"
+
+namespace xg::timer {
+
+Wheel::Wheel(const WheelGeometry& geometry, long long current)
+        : _level_bits(geometry.GetLevelBits()), _levels(geometry.GetLevels()), _slot_mask(geometry.GetSlots() - 1),
+          _horizon(geometry.GetHorizon()), _current(current), _size(0),
+          _slots((size_t)geometry.GetLevels() * geometry.GetSlots(), nullptr),
+          _words(std::max(geometry.GetSlots() / 64, (long long)1)), _occupied((size_t)(_levels * _words), 0),
+          _overflow(nullptr), _overflow_size(0) { }
+
+Wheel::~Wheel() { }
+
+void Wheel::link_(Task** slot, Task* task)
+{
+    task->_slot = slot;
+    task->_prev = nullptr;
+    task->_next = *slot;
+    if (*slot) {
+        (*slot)->_prev = task;
+    }
+    *slot = task;
+    occupy_(slot, true);
+    ++_size;
+}
+
+void Wheel::occupy_(Task** slot, bool occupied)
+{
+    long long index = slot - _slots.data();
+    unsigned long long& word = _occupied[(index >> _level_bits) * _words + ((index & _slot_mask) >> 6)];
+    unsigned long long bit = 1ULL << (index & _slot_mask & 63);
+    word = occupied ? (word | bit) : (word & ~bit);
+}
+
+long long Wheel::scan_(int level, long long from, long long to) const
+{
+    const unsigned long long* words = &_occupied[level * _words];
+    for (long long index = from >> 6; (index << 6) < to; ++index) {
+        unsigned long long bits = words[index];
+        if (index == (from >> 6)) {
+            bits &= ~0ULL << (from & 63);
+        }
+        if (bits) {
+            long long position = (index << 6) + std::countr_zero(bits);
+            return (position < to) ? position : -1;
+        }
+    }
+    return -1;
+}
+
+long long Wheel::next_slot_(int level, long long from) const
+{
+    // From the start position to the level end, then wrap around.
+    long long position = scan_(level, from, _slot_mask + 1);
+    if (position < 0) {
+        position = scan_(level, 0, from);
+    }
+    return (position < 0) ? -1 : ((position - from) & _slot_mask);
+}
+
+long long Wheel::NextTick() const
+{
+    long long next = LLONG_MAX;
+    if (_overflow) {
+        next = std::max(_overflow->_expire - _horizon + 1, _current + 1);
+    }
+    for (int level = 0; level < _levels; ++level) {
+        // A level N slot is cascaded once the ticks below it wrap, the
+        // slot of the current position is reached only after a full turn.
+        int shift = level * _level_bits;
+        long long base = (_current >> shift) + 1;
+        long long distance = next_slot_(level, base & _slot_mask);
+        if (distance >= 0) {
+            next = std::min(next, (base + distance) << shift);
+        }
+    }
+    return next;
+}
+
+Task** Wheel::target_(Task* task)
+{
+    long long expire = std::max(task->_expire, _current + 1);
+    long long delta = expire - _current;
+    if (delta >= _horizon) {
+        return nullptr;
+    }
+    int level = 0;
+    while (level < _levels - 1 && delta >= (1LL << ((level + 1) * _level_bits))) {
+        ++level;
+    }
+    return slot_(level, expire);
+}
+
+void Wheel::Insert(Task* task)
+{
+    Task** slot = target_(task);
+    if (!slot) {
+        overflow_push_(task);
+        return;
+    }
+    link_(slot, task);
+}
+
+void Wheel::InsertBatch(std::vector<Task*>& tasks)
+{
+    std::sort(tasks.begin(), tasks.end(), [](Task* first, Task* second) { return first->_expire < second->_expire; });
+    size_t index = 0;
+    while (index < tasks.size()) {
+        Task* first = tasks[index++];
+        Task** slot = target_(first);
+        if (!slot) {
+            overflow_push_(first);
+            continue;
+        }
+        first->_slot = slot;
+        first->_prev = nullptr;
+        Task* last = first;
+        size_t count = 1;
+        for (; index < tasks.size() && target_(tasks[index]) == slot; ++index, ++count) {
+            Task* task = tasks[index];
+            task->_slot = slot;
+            task->_prev = last;
+            last->_next = task;
+            last = task;
+        }
+        last->_next = *slot;
+        if (*slot) {
+            (*slot)->_prev = last;
+        }
+        *slot = first;
+        occupy_(slot, true);
+        _size += count;
+    }
+}
+
+Task* Wheel::meld_(Task* first, Task* second)
+{
+    if (!first) {
+        return second;
+    }
+    if (!second) {
+        return first;
+    }
+    if (second->_expire < first->_expire) {
+        std::swap(first, second);
+    }
+    // Second becomes the leftmost child, its _prev points to the parent.
+    second->_prev = first;
+    second->_next = first->_child;
+    if (first->_child) {
+        first->_child->_prev = second;
+    }
+    first->_child = second;
+    first->_prev = nullptr;
+    first->_next = nullptr;
+    return first;
+}
+
+Task* Wheel::merge_pairs_(Task* first)
+{
+    // Two pass pairing: meld pairs left to right, then fold right to left.
+    Task* pairs = nullptr;
+    while (first) {
+        Task* second = first->_next;
+        Task* rest = second ? second->_next : nullptr;
+        first->_prev = first->_next = nullptr;
+        if (second) {
+            second->_prev = second->_next = nullptr;
+        }
+        Task* pair = meld_(first, second);
+        pair->_next = pairs;
+        pairs = pair;
+        first = rest;
+    }
+    Task* root = nullptr;
+    while (pairs) {
+        Task* next = pairs->_next;
+        pairs->_next = nullptr;
+        root = meld_(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+void Wheel::overflow_push_(Task* task)
+{
+    task->_prev = task->_next = task->_child = nullptr;
+    task->_slot = &_overflow;
+    _overflow = meld_(_overflow, task);
+    ++_overflow_size;
+    ++_size;
+}
+
+void Wheel::overflow_remove_(Task* task)
+{
+    if (task == _overflow) {
+        _overflow = merge_pairs_(task->_child);
+    } else {
+        if (task->_prev->_child == task) {
+            task->_prev->_child = task->_next;
+        } else {
+            task->_prev->_next = task->_next;
+        }
+        if (task->_next) {
+            task->_next->_prev = task->_prev;
+        }
+        _overflow = meld_(_overflow, merge_pairs_(task->_child));
+    }
+    task->_prev = task->_next = task->_child = nullptr;
+    task->_slot = nullptr;
+    --_overflow_size;
+    --_size;
+}
+
+void Wheel::overflow_feed_()
+{
+    while (_overflow && _overflow->_expire - _current < _horizon) {
+        Task* task = _overflow;
+        overflow_remove_(task);
+        Insert(task);
+    }
+}
+
+long long Wheel::Coalesce(long long expire, long long slack)
+{
+    if (slack <= 0) {
+        return expire;
+    }
+    long long granularity = (long long)std::bit_floor((unsigned long long)slack + 1);
+    return (expire + granularity - 1) & ~(granularity - 1);
+}
+
+void Wheel::Remove(Task* task)
+{
+    if (!task->_slot) {
+        return;
+    }
+    if (task->_slot == &_overflow) {
+        overflow_remove_(task);
+        return;
+    }
+    if (task->_prev) {
+        task->_prev->_next = task->_next;
+    } else {
+        *task->_slot = task->_next;
+    }
+    if (task->_next) {
+        task->_next->_prev = task->_prev;
+    }
+    if (!*task->_slot) {
+        occupy_(task->_slot, false);
+    }
+    task->_prev = nullptr;
+    task->_next = nullptr;
+    task->_slot = nullptr;
+    --_size;
+}
+
+void Wheel::cascade_(int level)
+{
+    Task** slot = slot_(level, _current);
+    Task* task = *slot;
+    *slot = nullptr;
+    occupy_(slot, false);
+    while (task) {
+        Task* next = task->_next;
+        task->_prev = nullptr;
+        task->_next = nullptr;
+        task->_slot = nullptr;
+        --_size;
+        // Due on this very tick, the level 0 slot is expired right after.
+        if (task->_expire <= _current) {
+            link_(slot_(0, _current), task);
+        } else {
+            Insert(task);
+        }
+        task = next;
+    }
+}
+
+void Wheel::Advance(long long tick, std::vector<Task*>& expired)
+{
+    while (_current < tick) {
+        // Nothing happens in between, jump straight to the next event.
+        long long next = NextTick();
+        if (next > tick) {
+            _current = tick;
+            break;
+        }
+        _current = next;
+        overflow_feed_();
+        for (int level = 1; level < _levels; ++level) {
+            if (_current & ((1LL << (level * _level_bits)) - 1)) {
+                break;
+            }
+            cascade_(level);
+        }
+        Task** slot = slot_(0, _current);
+        Task* task = *slot;
+        *slot = nullptr;
+        occupy_(slot, false);
+        while (task) {
+            Task* next = task->_next;
+            task->_prev = nullptr;
+            task->_next = nullptr;
+            task->_slot = nullptr;
+            --_size;
+            expired.push_back(task);
+            task = next;
+        }
+    }
+}
+
+void Wheel::Clear(std::vector<Task*>& tasks)
+{
+    for (auto& slot : _slots) {
+        Task* task = slot;
+        slot = nullptr;
+        while (task) {
+            Task* next = task->_next;
+            task->_prev = nullptr;
+            task->_next = nullptr;
+            task->_slot = nullptr;
+            tasks.push_back(task);
+            task = next;
+        }
+    }
+    // Overflow heap, depth first through child and sibling links.
+    std::vector<Task*> stack;
+    if (_overflow) {
+        stack.push_back(_overflow);
+    }
+    while (!stack.empty()) {
+        Task* task = stack.back();
+        stack.pop_back();
+        if (task->_next) {
+            stack.push_back(task->_next);
+        }
+        if (task->_child) {
+            stack.push_back(task->_child);
+        }
+        task->_prev = task->_next = task->_child = nullptr;
+        task->_slot = nullptr;
+        tasks.push_back(task);
+    }
+    std::fill(_occupied.begin(), _occupied.end(), 0);
+    _overflow = nullptr;
+    _overflow_size = 0;
+    _size = 0;
+}
+
+}
@@ -1,12 +1,134 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-16 14:30
+ * @file     : timer_wheel.hh
+ * @brief    : Hierarchical timing wheel.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
 #ifndef __TIMER_WHEEL_HH__
 #define __TIMER_WHEEL_HH__
 
+#include <vector>
+
+#include "timer_task.hh"
+#include "timer_wheel_geometry.hh"
+
 namespace xg::timer {
 
+/**
+* @brief - Hierarchical timing wheel (Varghese & Lauck).
+*          Level N holds tasks due within 2^(bits * (N + 1)) ticks, one slot
+*          per 2^(bits * N) ticks, bits and levels from the WheelGeometry.
+*          Higher level slots are cascaded down when the lower level wraps.
+*          Tasks past the horizon wait in an overflow pairing heap and move
+*          into the wheel once in range, so they are never cascaded before.
+*          Each level keeps an occupancy bitmap, Advance finds the next
+*          non-empty slot by bit scan and jumps over empty ticks.
+*          Not thread safe, owned by a single worker.
+*/
 class Wheel {
-    
+public:
+    Wheel(const WheelGeometry& geometry, long long current);
+    ~Wheel();
+
+    /**
+    * @brief Insert - Link a task by its expire tick.
+    *                 Already expired tasks fire on the next tick.
+    */
+    void Insert(Task* task);
+
+    /**
+    * @brief InsertBatch - Link many tasks. Tasks are sorted by expire tick,
+    *                      each run bound for one slot is chained up front
+    *                      and spliced in with a single slot touch.
+    *
+    * @param [tasks] - Tasks to link, reordered.
+    */
+    void InsertBatch(std::vector<Task*>& tasks);
+
+    /**
+    * @brief Remove - Unlink a task, no-op when not linked.
+    */
+    void Remove(Task* task);
+
+    /**
+    * @brief Advance - Move the wheel to tick and collect expired tasks.
+    *
+    * @param [tick] - Target tick, not before the current tick.
+    * @param [expired] - Expired tasks are appended, already unlinked.
+    */
+    void Advance(long long tick, std::vector<Task*>& expired);
+
+    /**
+    * @brief Clear - Unlink every task.
+    *
+    * @param [tasks] - Unlinked tasks are appended.
+    */
+    void Clear(std::vector<Task*>& tasks);
+
+    /**
+    * @brief Coalesce - Round an expire tick up within slack ticks.
+    *                   The tick is aligned to the largest power of two that
+    *                   fits the slack, so timers with similar deadlines share
+    *                   one slot and fire in one batch. Large slacks align to
+    *                   higher level slot boundaries, such tasks fire right
+    *                   at cascade without passing through the lower levels.
+    *
+    * @param [expire] - Expire tick.
+    * @param [slack] - Tolerated delay in ticks.
+    *
+    * @returns  Coalesced expire tick, within [expire, expire + slack].
+    */
+    static long long Coalesce(long long expire, long long slack);
+
+    /**
+    * @brief NextTick - Tick of the next wheel event: an expiry, a cascade
+    *                   or an overflow task coming in range.
+    *
+    * @returns  Tick after the current one, LLONG_MAX when empty.
+    */
+    long long NextTick() const;
+
+    long long GetCurrent() const { return _current; }
+    size_t Size() const { return _size; }
+    size_t OverflowSize() const { return _overflow_size; }
+
+private:
+    Task** slot_(int level, long long tick) {
+        return &_slots[(level << _level_bits) + (tick >> (level * _level_bits) & _slot_mask)];
+    }
+    Task** target_(Task* task);
+    void link_(Task** slot, Task* task);
+    void occupy_(Task** slot, bool occupied);
+    long long scan_(int level, long long from, long long to) const;
+    long long next_slot_(int level, long long from) const;
+    void cascade_(int level);
+
+    // Overflow pairing heap, linked through Task::_prev/_next/_child.
+    static Task* meld_(Task* first, Task* second);
+    static Task* merge_pairs_(Task* first);
+    void overflow_push_(Task* task);
+    void overflow_remove_(Task* task);
+    void overflow_feed_();
+
+private:
+    int _level_bits;
+    int _levels;
+    long long _slot_mask;
+    long long _horizon;
+
+    long long _current;
+    size_t _size;
+    std::vector<Task*> _slots;
+    long long _words;                           // bitmap words per level
+    std::vector<unsigned long long> _occupied;
+    Task* _overflow;
+    size_t _overflow_size;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
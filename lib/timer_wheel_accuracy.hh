@@ -2,6 +2,7 @@
 #define __TIMER_WHEEL_ACCURACY_HH__
 
 #include <mutex>
+#include <chrono>
 
 namespace xg::timer {
 
@@ -25,9 +26,14 @@ public:
         return _accuracy;
     }
 
+    /**
+    * @brief - Accuracy of one wheel, the singleton is the process default.
+    */
+    WheelAccuracy(std::chrono::nanoseconds accuracy) : _accuracy(accuracy) { }
+    WheelAccuracy(const WheelAccuracy& other) : _accuracy(other._accuracy) { }
+
 private:
     WheelAccuracy() : _accuracy(1000000) { }
-    WheelAccuracy(const WheelAccuracy&);
     WheelAccuracy& operator=(const WheelAccuracy&);
 
     WheelAccuracy& SetAccuracy(std::chrono::nanoseconds&& accuracy) {
@@ -0,0 +1,76 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-19 11:05
+ * @file     : timer_wheel_geometry.hh
+ * @brief    : Timer wheel geometry configuration.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_WHEEL_GEOMETRY_HH__
+#define __TIMER_WHEEL_GEOMETRY_HH__
+
+#include <chrono>
+
+#include "timer_wheel_accuracy.hh"
+
+#define TIMER_WHEEL_LEVEL_BITS (8)
+#define TIMER_WHEEL_LEVELS (4)
+#define TIMER_WHEEL_MAX_LEVEL_BITS (16)
+#define TIMER_WHEEL_MAX_HORIZON_BITS (62)
+
+namespace xg::timer {
+
+/**
+* @brief - Wheel geometry: tick size, slots per level and level count.
+*          Each WheelManager owns one, so fine short timeout shards and
+*          coarse long horizon shards can live side by side. The horizon
+*          is tick * 2^(level_bits * levels), later timers are parked.
+*/
+class WheelGeometry {
+public:
+    WheelGeometry(std::chrono::nanoseconds tick = std::chrono::milliseconds(1),
+                  int level_bits = TIMER_WHEEL_LEVEL_BITS, int levels = TIMER_WHEEL_LEVELS)
+            : _accuracy(tick), _tick(tick), _level_bits(level_bits), _levels(levels) { }
+
+    /**
+    * @brief Fine - Short timeouts: 100us ticks, 3 levels of 256 slots (~28 min).
+    */
+    static WheelGeometry Fine() {
+        return WheelGeometry(std::chrono::microseconds(100), 8, 3);
+    }
+
+    /**
+    * @brief Coarse - Long horizon cron jobs: 1s ticks, 5 levels of 64 slots (~34 years).
+    */
+    static WheelGeometry Coarse() {
+        return WheelGeometry(std::chrono::seconds(1), 6, 5);
+    }
+
+    bool Valid() const {
+        return (_tick.count() > 0 && _level_bits > 0 && _level_bits <= TIMER_WHEEL_MAX_LEVEL_BITS
+                && _levels > 0 && _level_bits * _levels <= TIMER_WHEEL_MAX_HORIZON_BITS);
+    }
+
+    WheelAccuracy& GetAccuracy() { return _accuracy; }
+    std::chrono::nanoseconds GetTick() const { return _tick; }
+    int GetLevelBits() const { return _level_bits; }
+    int GetLevels() const { return _levels; }
+    long long GetSlots() const { return (1LL << _level_bits); }
+
+    /**
+    * @brief GetHorizon - Ticks covered by the wheel before parking.
+    */
+    long long GetHorizon() const { return (1LL << (_level_bits * _levels)); }
+
+private:
+    WheelAccuracy _accuracy;
+    std::chrono::nanoseconds _tick;
+    int _level_bits;
+    int _levels;
+};
+
+}
+
+#endif
@@ -0,0 +1,409 @@
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "timer_log.hh"
+#include "timer_numa.hh"
+#include "timer_task_pool.hh"
+#include "timer_rule_crontab.hh"
+#include "timer_wheel_manager.hh"
+
+// Rules compiled per claim of a loader thread.
+#define TIMER_LOAD_CHUNK ((size_t)64)
+
+namespace xg::timer {
+
+namespace {
+
+// Scheduled and not cancelled, a job still runs on its task.
+bool job_live(const std::shared_ptr<Task>& task)
+{
+    TaskState state = task->GetState();
+    return !task->Cancelled() && (state == TaskState::Pending || state == TaskState::Firing);
+}
+
+}
+
+WheelManager::WheelManager(size_t workers, const WheelGeometry& geometry)
+        : _geometry(geometry.Valid() ? geometry : WheelGeometry()), _next(0)
+{
+    if (!geometry.Valid()) {
+        TIMER_WHEEL_ERROR("Invalid wheel geometry, fall back to default");
+    }
+    for (size_t index = 0; index < std::max(workers, (size_t)1); ++index) {
+        _workers.push_back(std::make_unique<WheelWorker>(_geometry));
+    }
+}
+
+WheelManager::~WheelManager()
+{
+    Stop();
+}
+
+Return WheelManager::SetAffinity(size_t worker, const std::vector<int>& cpus)
+{
+    if (worker >= _workers.size()) {
+        return Return::ERROR;
+    }
+    return _workers[worker]->SetAffinity(cpus);
+}
+
+Return WheelManager::SpreadNodes()
+{
+    Numa& numa = Numa::Instance();
+    for (size_t index = 0; index < _workers.size(); ++index) {
+        Return ret = _workers[index]->SetAffinity(numa.GetCpus((int)(index % numa.GetNodes())));
+        if (ret != Return::SUCCESS) {
+            return ret;
+        }
+    }
+    return Return::SUCCESS;
+}
+
+Return WheelManager::Start()
+{
+    for (auto& worker : _workers) {
+        Return ret = worker->Start();
+        if (ret != Return::SUCCESS) {
+            return ret;
+        }
+    }
+    TIMER_WHEEL_INFO("Started [", _workers.size(), "] wheel workers");
+    return Return::SUCCESS;
+}
+
+Return WheelManager::Stop()
+{
+    for (auto& worker : _workers) {
+        worker->Stop();
+    }
+    return Return::SUCCESS;
+}
+
+std::tuple<Return, std::shared_ptr<Task>>
+WheelManager::Schedule(TaskRule rule, Task::Callback callback, bool repeat, std::chrono::nanoseconds slack)
+{
+    return schedule_(next_worker_(), nullptr, std::move(rule), std::move(callback), repeat, slack);
+}
+
+std::tuple<Return, std::shared_ptr<Task>>
+WheelManager::Schedule(const std::shared_ptr<TimerGroup>& group, TaskRule rule, Task::Callback callback,
+                       bool repeat, std::chrono::nanoseconds slack)
+{
+    if (!group) {
+        return {Return::EWHEEL_TASK_INVALID, nullptr};
+    }
+    if (group->Cancelled()) {
+        return {Return::EWHEEL_GROUP_CANCELLED, nullptr};
+    }
+    return schedule_(group->_worker, group, std::move(rule), std::move(callback), repeat, slack);
+}
+
+Return WheelManager::Touch(const std::shared_ptr<Task>& task, std::chrono::nanoseconds timeout)
+{
+    // Wall clock rules follow the calendar, not activity.
+    if (!task || !task->_worker || task->_wall) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    // TSC read, one tick ahead so its calibration error never fires early.
+    auto deadline = Clock::Instance().Fast() + timeout + _geometry.GetTick();
+    task->_touched.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+    return Return::SUCCESS;
+}
+
+std::tuple<Return, std::vector<std::shared_ptr<Task>>> WheelManager::ScheduleBatch(std::span<TaskSpec> specs)
+{
+    return schedule_batch_(specs, {});
+}
+
+std::tuple<Return, std::vector<std::shared_ptr<Task>>> WheelManager::LoadCrontab(std::span<CrontabSpec> specs, size_t threads)
+{
+    std::scoped_lock lock(_jobs_mutex);
+    auto loaded = load_crontab_(specs, threads);
+    for (size_t index = 0; index < specs.size(); ++index) {
+        if (std::get<1>(loaded)[index] && !specs[index].id.empty()) {
+            keep_job_(specs[index], std::get<1>(loaded)[index]);
+        }
+    }
+    return loaded;
+}
+
+std::tuple<Return, std::vector<std::shared_ptr<Task>>> WheelManager::load_crontab_(std::span<CrontabSpec> specs, size_t threads)
+{
+    // Same normalized rule text and zone, one compiled rule shared by all its jobs.
+    std::unordered_map<std::string, size_t> unique_index;
+    std::vector<const CrontabSpec*> uniques;
+    std::vector<std::string> unique_rules;
+    std::vector<size_t> which(specs.size());
+    for (size_t index = 0; index < specs.size(); ++index) {
+        std::string rule = RuleCrontab::Normalize(specs[index].rule);
+        auto it = unique_index.try_emplace(rule + '\0' + specs[index].zone, uniques.size()).first;
+        if (it->second == uniques.size()) {
+            uniques.push_back(&specs[index]);
+            unique_rules.push_back(std::move(rule));
+        }
+        which[index] = it->second;
+    }
+
+    std::vector<std::shared_ptr<RuleCrontab>> rules(uniques.size());
+    std::vector<Rule::RefTimePoint> firsts(uniques.size());
+    Rule::RefTimePoint now = Clock::Instance().ToWall(Clock::Now());
+    std::atomic<size_t> next(0);
+    auto compile = [&]() {
+        size_t begin;
+        while ((begin = next.fetch_add(TIMER_LOAD_CHUNK, std::memory_order_relaxed)) < uniques.size()) {
+            for (size_t index = begin; index < std::min(begin + TIMER_LOAD_CHUNK, uniques.size()); ++index) {
+                const CrontabSpec* spec = uniques[index];
+                // A throw would end the process from a helper thread, the
+                // rule is left empty and its jobs fail as invalid instead.
+                try {
+                    rules[index] = spec->zone.empty() ? std::make_shared<RuleCrontab>(now, unique_rules[index])
+                                                      : std::make_shared<RuleCrontab>(now, unique_rules[index], spec->zone);
+                } catch (const std::exception& e) {
+                    TIMER_WHEEL_ERROR("Compile crontab rule[", unique_rules[index], "] failed: ", e.what());
+                    continue;
+                }
+                // Also leaves the rule's memo on the window of its first fire.
+                auto first = rules[index]->GetNextExprieTime(Rule::RefTimePoint(now));
+                if (std::get<0>(first) == Return::SUCCESS) {
+                    firsts[index] = std::get<1>(first);
+                }
+            }
+        }
+    };
+    if (!threads) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    threads = std::min(threads, (uniques.size() + TIMER_LOAD_CHUNK - 1) / TIMER_LOAD_CHUNK);
+    std::vector<std::thread> helpers;
+    for (size_t thread = 1; thread < threads; ++thread) {
+        helpers.emplace_back(compile);
+    }
+    compile();
+    for (auto& helper : helpers) {
+        helper.join();
+    }
+
+    std::vector<TaskSpec> tasks(specs.size());
+    std::vector<Rule::RefTimePoint> task_firsts(specs.size());
+    for (size_t index = 0; index < specs.size(); ++index) {
+        tasks[index] = {rules[which[index]], std::move(specs[index].callback), specs[index].repeat,
+                        specs[index].slack, specs[index].group};
+        task_firsts[index] = firsts[which[index]];
+    }
+    return schedule_batch_(tasks, task_firsts);
+}
+
+std::tuple<Return, std::vector<std::shared_ptr<Task>>> WheelManager::Reload(std::span<CrontabSpec> specs, size_t threads)
+{
+    std::scoped_lock lock(_jobs_mutex);
+    Return ret = Return::SUCCESS;
+    std::vector<std::shared_ptr<Task>> tasks(specs.size());
+    std::unordered_set<std::string> ids;
+    std::vector<CrontabSpec> changed;
+    std::vector<size_t> changed_index;
+    size_t kept = 0;
+    for (size_t index = 0; index < specs.size(); ++index) {
+        CrontabSpec& spec = specs[index];
+        if (!ids.insert(spec.id).second) {
+            if (ret == Return::SUCCESS) {
+                ret = Return::ESCHEDULE_RULE_CONFLICT;
+            }
+            continue;
+        }
+        std::string rule = RuleCrontab::Normalize(spec.rule);
+        auto it = _jobs.find(spec.id);
+        if (it != _jobs.end() && job_live(it->second.task) && it->second.rule == rule && it->second.zone == spec.zone
+                && it->second.repeat == spec.repeat && it->second.slack == spec.slack && it->second.group == spec.group) {
+            tasks[index] = it->second.task;
+            ++kept;
+            continue;
+        }
+        changed.push_back({spec.id, std::move(rule), spec.zone, std::move(spec.callback), spec.repeat, spec.slack, spec.group});
+        changed_index.push_back(index);
+    }
+
+    size_t removed = 0;
+    for (auto it = _jobs.begin(); it != _jobs.end();) {
+        if (ids.count(it->first)) {
+            ++it;
+            continue;
+        }
+        Cancel(it->second.task);
+        it = _jobs.erase(it);
+        ++removed;
+    }
+
+    auto loaded = load_crontab_(changed, threads);
+    if (std::get<0>(loaded) != Return::SUCCESS && ret == Return::SUCCESS) {
+        ret = std::get<0>(loaded);
+    }
+    for (size_t index = 0; index < changed.size(); ++index) {
+        auto& task = std::get<1>(loaded)[index];
+        // A bad new rule keeps the live job as it was, a finished one is dropped.
+        if (!task) {
+            auto it = _jobs.find(changed[index].id);
+            if (it != _jobs.end() && !job_live(it->second.task)) {
+                _jobs.erase(it);
+            }
+            continue;
+        }
+        keep_job_(changed[index], task);
+        tasks[changed_index[index]] = task;
+    }
+    TIMER_WHEEL_INFO("Reloaded crontab jobs, kept [", kept, "] loaded [", changed.size(),
+            "] removed [", removed, "]");
+    return {ret, std::move(tasks)};
+}
+
+void WheelManager::keep_job_(const CrontabSpec& spec, const std::shared_ptr<Task>& task)
+{
+    CrontabJob& job = _jobs[spec.id];
+    // Replaced only now that its successor is scheduled.
+    if (job.task) {
+        Cancel(job.task);
+    }
+    job = {RuleCrontab::Normalize(spec.rule), spec.zone, spec.repeat, spec.slack, spec.group, task};
+}
+
+std::tuple<Return, std::vector<std::shared_ptr<Task>>>
+WheelManager::schedule_batch_(std::span<TaskSpec> specs, std::span<const Rule::RefTimePoint> firsts)
+{
+    Return ret = Return::SUCCESS;
+    std::vector<std::shared_ptr<Task>> tasks(specs.size());
+    std::vector<std::vector<std::shared_ptr<Task>>> shards(_workers.size());
+    size_t next = _next.fetch_add(specs.size(), std::memory_order_relaxed);
+    for (size_t index = 0; index < specs.size(); ++index) {
+        TaskSpec& spec = specs[index];
+        if (!spec.rule.Valid(_geometry.GetAccuracy())) {
+            if (ret == Return::SUCCESS) {
+                ret = Return::ESCHEDULE_RULE_INVALID;
+            }
+            continue;
+        }
+        if (!spec.callback) {
+            if (ret == Return::SUCCESS) {
+                ret = Return::EWHEEL_TASK_INVALID;
+            }
+            continue;
+        }
+        if (spec.group && spec.group->Cancelled()) {
+            if (ret == Return::SUCCESS) {
+                ret = Return::EWHEEL_GROUP_CANCELLED;
+            }
+            continue;
+        }
+        size_t shard = (next + index) % _workers.size();
+        if (spec.group) {
+            shard = std::find_if(_workers.begin(), _workers.end(),
+                    [&spec](auto& worker) { return worker.get() == &spec.group->_worker; }) - _workers.begin();
+            // Group of another manager.
+            if (shard == _workers.size()) {
+                if (ret == Return::SUCCESS) {
+                    ret = Return::EWHEEL_TASK_INVALID;
+                }
+                continue;
+            }
+        }
+        tasks[index] = TaskPool::Instance().Make(_workers[shard]->GetNode(), TaskRule(spec.rule), std::move(spec.callback),
+                spec.repeat, spec.slack);
+        tasks[index]->_group = spec.group;
+        // Precomputed first fire, the worker only places the task.
+        if (index < firsts.size() && firsts[index].time_since_epoch().count()) {
+            tasks[index]->_walltime = firsts[index];
+            tasks[index]->_preset = true;
+        }
+        shards[shard].push_back(tasks[index]);
+    }
+    for (size_t shard = 0; shard < shards.size(); ++shard) {
+        if (shards[shard].empty()) {
+            continue;
+        }
+        if (!firsts.empty()) {
+            // Handed over in fire order, the worker's slot sort is then a pass.
+            std::stable_sort(shards[shard].begin(), shards[shard].end(),
+                    [](const auto& left, const auto& right) { return left->_walltime < right->_walltime; });
+        }
+        Return added = _workers[shard]->AddBatch(shards[shard]);
+        if (added != Return::SUCCESS && ret == Return::SUCCESS) {
+            ret = added;
+        }
+    }
+    // Tasks of a failed submission were never handed to a worker.
+    for (auto& task : tasks) {
+        if (task && !task->_worker) {
+            task.reset();
+        }
+    }
+    return {ret, std::move(tasks)};
+}
+
+std::shared_ptr<TimerGroup> WheelManager::CreateGroup()
+{
+    return std::make_shared<TimerGroup>(next_worker_());
+}
+
+Return WheelManager::Cancel(const std::shared_ptr<TimerGroup>& group)
+{
+    if (!group) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    return group->_worker.CancelGroup(group);
+}
+
+Return WheelManager::Reschedule(const std::shared_ptr<TimerGroup>& group, std::chrono::nanoseconds offset)
+{
+    if (!group) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    return group->_worker.ShiftGroup(group, offset);
+}
+
+std::tuple<Return, std::shared_ptr<Task>>
+WheelManager::schedule_(WheelWorker& worker, const std::shared_ptr<TimerGroup>& group, TaskRule&& rule,
+                        Task::Callback&& callback, bool repeat, std::chrono::nanoseconds slack)
+{
+    if (!rule.Valid(_geometry.GetAccuracy())) {
+        return {Return::ESCHEDULE_RULE_INVALID, nullptr};
+    }
+    // The worker calls it without a check.
+    if (!callback) {
+        return {Return::EWHEEL_TASK_INVALID, nullptr};
+    }
+    auto task = TaskPool::Instance().Make(worker.GetNode(), std::move(rule), std::move(callback), repeat, slack);
+    task->_group = group;
+    Return ret = worker.Add(task);
+    if (ret != Return::SUCCESS) {
+        return {ret, nullptr};
+    }
+    return {Return::SUCCESS, task};
+}
+
+TimerAwaiter WheelManager::SleepFor(std::chrono::nanoseconds duration)
+{
+    return TimerAwaiter(next_worker_(), Clock::Instance().Fast() + duration + _geometry.GetTick());
+}
+
+TimerAwaiter WheelManager::SleepUntil(const Clock::TimePoint& time)
+{
+    return TimerAwaiter(next_worker_(), time);
+}
+
+TimerAwaiter WheelManager::NextFire(TaskRule rule)
+{
+    if (!rule.Valid(_geometry.GetAccuracy())) {
+        return TimerAwaiter(next_worker_(), nullptr, Return::ESCHEDULE_RULE_INVALID);
+    }
+    return TimerAwaiter(next_worker_(), std::move(rule));
+}
+
+Return WheelManager::Cancel(const std::shared_ptr<Task>& task)
+{
+    if (!task || !task->_worker) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    return task->_worker->Cancel(task);
+}
+
+}
@@ -1,12 +1,279 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-17 15:20
+ * @file     : timer_wheel_manager.hh
+ * @brief    : Timer entry, spreads tasks over wheel workers.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
 #ifndef __TIMER_WHEEL_MANAGER_HH__
 #define __TIMER_WHEEL_MANAGER_HH__
 
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+#include "timer_return.hh"
+#include "timer_rule.hh"
+#include "timer_task.hh"
+#include "timer_task_rule.hh"
+#include "timer_group.hh"
+#include "timer_wheel_geometry.hh"
+#include "timer_wheel_worker.hh"
+#include "timer_awaiter.hh"
+
 namespace xg::timer {
 
+/**
+* @brief - One entry of a batch schedule, same meaning as the Schedule
+*          arguments. A null group spreads the task over the workers.
+*/
+struct TaskSpec {
+    TaskRule rule;
+    Task::Callback callback;
+    bool repeat = true;
+    std::chrono::nanoseconds slack = std::chrono::nanoseconds(0);
+    std::shared_ptr<TimerGroup> group;
+};
+
+/**
+* @brief - One job of a bulk crontab load, rule given as text.
+*/
+struct CrontabSpec {
+    std::string id;             // job id, the key of Reload, empty for none
+    std::string rule;
+    std::string zone;           // IANA zone name, empty for UTC
+    Task::Callback callback;
+    bool repeat = true;
+    std::chrono::nanoseconds slack = std::chrono::nanoseconds(0);
+    std::shared_ptr<TimerGroup> group;
+};
+
+/**
+* @brief - Timer manager, owns a set of wheel workers (shards).
+*          New tasks are spread over the workers round robin. All workers
+*          share the manager's wheel geometry.
+*/
 class WheelManager {
-    
+public:
+    WheelManager(size_t workers = 1, const WheelGeometry& geometry = WheelGeometry());
+    ~WheelManager();
+
+    Return Start();
+    Return Stop();
+
+    WheelGeometry& GetGeometry() { return _geometry; }
+
+    /**
+    * @brief SetAffinity - Pin one worker to cpus, before Start.
+    *
+    * @param [worker] - Worker index.
+    * @param [cpus] - Cpu ids.
+    *
+    * @returns  Return class.
+    */
+    Return SetAffinity(size_t worker, const std::vector<int>& cpus);
+
+    /**
+    * @brief SpreadNodes - Pin workers round robin over NUMA nodes, each to
+    *                      all cpus of its node, before Start.
+    *
+    * @returns  Return class.
+    */
+    Return SpreadNodes();
+
+    /**
+    * @brief Schedule - Schedule a callback by rule.
+    *
+    * @param [rule] - Scheduling rule. A RuleDuration value is kept inline in
+    *                  the task, a shared rule may be shared by several tasks.
+    * @param [callback] - Called on the worker thread on every fire. Move
+    *                      only, kept inline up to TIMER_FUNCTION_INLINE_SIZE
+    *                      bytes of captures, with the task in a pool block.
+    * @param [repeat] - Keep firing by rule, or fire once.
+    * @param [slack] - Tolerated delay after each fire time, lets the wheel
+    *                  coalesce nearby timers into one slot.
+    *
+    * @returns  Tuple of Return class & task handle.
+    */
+    std::tuple<Return, std::shared_ptr<Task>>
+    Schedule(TaskRule rule, Task::Callback callback, bool repeat = true,
+             std::chrono::nanoseconds slack = std::chrono::nanoseconds(0));
+
+    /**
+    * @brief ScheduleBatch - Schedule many tasks at once.
+    *                        Tasks are grouped by worker and posted with one
+    *                        queue submission per worker, the worker links
+    *                        them slot by slot in one pass.
+    *
+    * @param [specs] - Task entries, callbacks are moved from.
+    *
+    * @returns  Tuple of Return class & task handles in entry order. On a
+    *           bad entry the first error is returned and its handle is
+    *           null, the other entries are still scheduled.
+    */
+    std::tuple<Return, std::vector<std::shared_ptr<Task>>> ScheduleBatch(std::span<TaskSpec> specs);
+
+    /**
+    * @brief LoadCrontab - Bulk load of crontab jobs, e.g. at startup.
+    *                      Rules are parsed and their first fire times
+    *                      computed on several threads, jobs with the same
+    *                      rule text and zone share one compiled rule. The
+    *                      tasks then go through ScheduleBatch, sorted by
+    *                      first fire per worker.
+    *                      Jobs with an id join the live job set of Reload,
+    *                      replacing a live job of the same id.
+    *
+    * @param [specs] - Jobs, callbacks are moved from.
+    * @param [threads] - Parsing threads, 0 for one per hardware thread.
+    *
+    * @returns  Same as ScheduleBatch.
+    */
+    std::tuple<Return, std::vector<std::shared_ptr<Task>>> LoadCrontab(std::span<CrontabSpec> specs, size_t threads = 0);
+
+    /**
+    * @brief Reload - Replace the live crontab job set, e.g. on a config change.
+    *                 Jobs are matched by id against the jobs of earlier
+    *                 loads and reloads. A job whose task is still scheduled
+    *                 and whose normalized rule text, zone, repeat, slack and
+    *                 group are unchanged keeps its task and next fire, its
+    *                 new callback is dropped. A job whose task finished or
+    *                 was cancelled is scheduled again. Added
+    *                 and changed jobs go through LoadCrontab, a changed job's
+    *                 old task is cancelled once its new one is scheduled, and
+    *                 jobs missing from the new set are cancelled. The cost is
+    *                 bound by the number of changed jobs.
+    *
+    * @param [specs] - New job set with unique ids, callbacks of added and
+    *                  changed jobs are moved from.
+    * @param [threads] - Parsing threads, see LoadCrontab.
+    *
+    * @returns  Tuple of Return class & live task handles in entry order. A
+    *           duplicate id fails with ESCHEDULE_RULE_CONFLICT. On a bad
+    *           entry the first error is returned and its handle is null, a
+    *           live job of the same id is kept as it was.
+    */
+    std::tuple<Return, std::vector<std::shared_ptr<Task>>> Reload(std::span<CrontabSpec> specs, size_t threads = 0);
+
+    /**
+    * @brief Cancel - Cancel a scheduled task.
+    *
+    * @param [task] - Task handle returned by Schedule.
+    *
+    * @returns  Return class.
+    */
+    Return Cancel(const std::shared_ptr<Task>& task);
+
+    /**
+    * @brief Touch - Push an idle timer's deadline out, e.g. on every packet.
+    *                Only stores the new deadline, the worker re-slots the
+    *                task lazily when its old slot expires. A touch racing
+    *                with that expiry may be missed.
+    *
+    * @param [task] - Task handle of a duration rule.
+    * @param [timeout] - New deadline from now, read off the TSC, plus one
+    *                     tick so it is never early.
+    *
+    * @returns  Return class.
+    */
+    Return Touch(const std::shared_ptr<Task>& task, std::chrono::nanoseconds timeout);
+
+    /**
+    * @brief CreateGroup - New timer group, bound to one worker.
+    */
+    std::shared_ptr<TimerGroup> CreateGroup();
+
+    /**
+    * @brief Schedule - Schedule a callback by rule as a member of a group.
+    *
+    * @param [group] - Group from CreateGroup, not cancelled.
+    *
+    * @returns  Tuple of Return class & task handle.
+    */
+    std::tuple<Return, std::shared_ptr<Task>>
+    Schedule(const std::shared_ptr<TimerGroup>& group, TaskRule rule, Task::Callback callback,
+             bool repeat = true, std::chrono::nanoseconds slack = std::chrono::nanoseconds(0));
+
+    /**
+    * @brief Cancel - Cancel every member of a group and close it.
+    *
+    * @param [group] - Group from CreateGroup.
+    *
+    * @returns  Return class.
+    */
+    Return Cancel(const std::shared_ptr<TimerGroup>& group);
+
+    /**
+    * @brief Reschedule - Move the next fire of every member of a group.
+    *
+    * @param [group] - Group from CreateGroup.
+    * @param [offset] - Added to each member's deadline, may be negative.
+    *
+    * @returns  Return class.
+    */
+    Return Reschedule(const std::shared_ptr<TimerGroup>& group, std::chrono::nanoseconds offset);
+
+    /**
+    * @brief SleepFor - Awaitable, resumes the coroutine after duration,
+    *                   at most one tick late on top of the wheel's own
+    *                   lateness. e.g. co_await manager.SleepFor(10ms);
+    */
+    TimerAwaiter SleepFor(std::chrono::nanoseconds duration);
+
+    /**
+    * @brief SleepUntil - Awaitable, resumes the coroutine at a wheel time.
+    */
+    TimerAwaiter SleepUntil(const Clock::TimePoint& time);
+
+    /**
+    * @brief NextFire - Awaitable, resumes the coroutine at the next fire of
+    *                   rule, co_await yields the fire wall time.
+    */
+    TimerAwaiter NextFire(TaskRule rule);
+
+private:
+    // Live job of LoadCrontab and Reload.
+    struct CrontabJob {
+        std::string rule;           // normalized rule text
+        std::string zone;
+        bool repeat;
+        std::chrono::nanoseconds slack;
+        std::shared_ptr<TimerGroup> group;
+        std::shared_ptr<Task> task;
+    };
+
+    std::tuple<Return, std::vector<std::shared_ptr<Task>>> load_crontab_(std::span<CrontabSpec> specs, size_t threads);
+    void keep_job_(const CrontabSpec& spec, const std::shared_ptr<Task>& task);
+
+    std::tuple<Return, std::vector<std::shared_ptr<Task>>>
+    schedule_batch_(std::span<TaskSpec> specs, std::span<const Rule::RefTimePoint> firsts);
+
+    std::tuple<Return, std::shared_ptr<Task>>
+    schedule_(WheelWorker& worker, const std::shared_ptr<TimerGroup>& group, TaskRule&& rule,
+              Task::Callback&& callback, bool repeat, std::chrono::nanoseconds slack);
+
+    WheelWorker& next_worker_() {
+        return *_workers[_next.fetch_add(1, std::memory_order_relaxed) % _workers.size()];
+    }
+
+private:
+    WheelManager(const WheelManager&);
+    WheelManager& operator=(const WheelManager&);
+
+private:
+    WheelGeometry _geometry;
+    std::vector<std::unique_ptr<WheelWorker>> _workers;
+    std::atomic<size_t> _next;
+    std::mutex _jobs_mutex;     // serializes LoadCrontab and Reload
+    std::unordered_map<std::string, CrontabJob> _jobs;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,498 @@
+#include <algorithm>
+
+#include "timer_log.hh"
+#include "timer_numa.hh"
+#include "timer_wheel_worker.hh"
+
+namespace xg::timer {
+
+WheelWorker::WheelWorker(const WheelGeometry& geometry)
+        : _accuracy(geometry.GetTick()), _geometry(geometry), _node(0), _running(false), _cancels(nullptr),
+          _wall_head(nullptr), _wall_size(0),
+          _generation(Clock::Instance().GetGeneration()), _step_generation(Clock::Instance().GetStepGeneration()),
+          _resync_time(Clock::Now()) { }
+
+WheelWorker::~WheelWorker()
+{
+    Stop();
+    reap_();
+    if (!_wheel) {
+        return;
+    }
+    // Suspended coroutines are left suspended, their owners destroy them.
+    std::vector<Task*> tasks;
+    _wheel->Clear(tasks);
+    for (auto task : tasks) {
+        leave_group_(task);
+        std::shared_ptr<Task> self = std::move(task->_self);
+    }
+}
+
+Return WheelWorker::Start()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_running) {
+        return Return::SUCCESS;
+    }
+    _running = true;
+    _thread = std::thread(&WheelWorker::run_, this);
+    // Queues are reserved by the worker, commands posted before would
+    // allocate on the caller.
+    _ready.wait(lock, [this]() { return _wheel != nullptr; });
+    return Return::SUCCESS;
+}
+
+Return WheelWorker::Stop()
+{
+    {
+        std::scoped_lock lock(_mutex);
+        if (!_running) {
+            return Return::SUCCESS;
+        }
+        _running = false;
+    }
+    _cond.notify_one();
+    _thread.join();
+    // Commands accepted but not yet taken by the worker. Nothing is posted
+    // any more, so they are applied here: added tasks land in the wheel and
+    // fire after a restart like the rest.
+    auto now = Clock::Now();
+    for (auto& command : _queue) {
+        apply_(command, now);
+    }
+    _queue.clear();
+    flush_();
+    reap_();
+    return Return::SUCCESS;
+}
+
+Return WheelWorker::SetAffinity(const std::vector<int>& cpus)
+{
+    std::scoped_lock lock(_mutex);
+    if (_running || _wheel) {
+        return Return::ERROR;
+    }
+    _cpus = cpus;
+    _node = cpus.empty() ? 0 : Numa::Instance().GetNode(cpus.front());
+    return Return::SUCCESS;
+}
+
+bool WheelWorker::Running()
+{
+    std::scoped_lock lock(_mutex);
+    return _running;
+}
+
+Return WheelWorker::Add(std::shared_ptr<Task> task)
+{
+    if (!task || task->_worker) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    {
+        std::scoped_lock lock(_mutex);
+        if (!_running) {
+            return Return::EWHEEL_NOT_RUNNING;
+        }
+        task->_worker = this;
+        _queue.push_back({CommandType::Add, std::move(task), nullptr, std::chrono::nanoseconds(0)});
+    }
+    _cond.notify_one();
+    return Return::SUCCESS;
+}
+
+Return WheelWorker::AddBatch(std::vector<std::shared_ptr<Task>>& tasks)
+{
+    for (auto& task : tasks) {
+        if (!task || task->_worker) {
+            return Return::EWHEEL_TASK_INVALID;
+        }
+    }
+    {
+        std::scoped_lock lock(_mutex);
+        if (!_running) {
+            return Return::EWHEEL_NOT_RUNNING;
+        }
+        for (auto& task : tasks) {
+            task->_worker = this;
+            _queue.push_back({CommandType::Add, std::move(task), nullptr, std::chrono::nanoseconds(0)});
+        }
+    }
+    _cond.notify_one();
+    return Return::SUCCESS;
+}
+
+Return WheelWorker::Cancel(std::shared_ptr<Task> task)
+{
+    if (!task || task->_worker != this) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    if (!task->cancel_()) {
+        // Done, or cancelled by someone else.
+        return Return::SUCCESS;
+    }
+    // Only the thread that cancelled pushes, once per task. The reference
+    // keeps the task alive until the worker pops it, even if it fires and
+    // finishes in between.
+    Task* raw = task.get();
+    raw->_cancel_ref = std::move(task);
+    raw->_cancel_next = _cancels.load(std::memory_order_relaxed);
+    while (!_cancels.compare_exchange_weak(raw->_cancel_next, raw, std::memory_order_release, std::memory_order_relaxed)) { }
+    return Return::SUCCESS;
+}
+
+Return WheelWorker::CancelGroup(std::shared_ptr<TimerGroup> group)
+{
+    if (!group || &group->_worker != this) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    group->_cancelled.store(true, std::memory_order_release);
+    return post_({CommandType::CancelGroup, nullptr, std::move(group), std::chrono::nanoseconds(0)});
+}
+
+Return WheelWorker::ShiftGroup(std::shared_ptr<TimerGroup> group, std::chrono::nanoseconds offset)
+{
+    if (!group || &group->_worker != this) {
+        return Return::EWHEEL_TASK_INVALID;
+    }
+    if (group->Cancelled()) {
+        return Return::EWHEEL_GROUP_CANCELLED;
+    }
+    return post_({CommandType::ShiftGroup, nullptr, std::move(group), offset});
+}
+
+Return WheelWorker::post_(Command&& command)
+{
+    {
+        std::scoped_lock lock(_mutex);
+        if (!_running) {
+            // Nothing left to fire, a cancel is already complete.
+            return Return::SUCCESS;
+        }
+        _queue.push_back(std::move(command));
+    }
+    _cond.notify_one();
+    return Return::SUCCESS;
+}
+
+void WheelWorker::run_()
+{
+    if (Numa::SetAffinity(_cpus) != Return::SUCCESS) {
+        TIMER_WHEEL_ERROR("Pin worker failed");
+    }
+    std::vector<Command> commands;
+    commands.reserve(TIMER_WORKER_QUEUE_RESERVE);
+    _expired.reserve(TIMER_WORKER_QUEUE_RESERVE);
+    _armed.reserve(TIMER_WORKER_QUEUE_RESERVE);
+    bool publishing = false;
+    std::unique_lock<std::mutex> lock(_mutex);
+    // First touch from the pinned thread.
+    if (!_wheel) {
+        _wheel = std::make_unique<Wheel>(_geometry, tick_(Clock::Now()));
+        _queue.reserve(TIMER_WORKER_QUEUE_RESERVE);
+    }
+    _ready.notify_all();
+    while (_running) {
+        if (_queue.empty()) {
+            // Sleep until the next wheel event, still waking up to resync.
+            long long next = std::min(_wheel->NextTick(), expire_tick_(_resync_time));
+            // Skipping ticks, the published time would go stale.
+            if (publishing && next > _wheel->GetCurrent() + 1) {
+                Clock::Instance().Detach();
+                publishing = false;
+            }
+            if (_wheel->Size()) {
+                _cond.wait_until(lock, Clock::TimePoint(next * _accuracy));
+            } else {
+                _cond.wait(lock);
+            }
+        }
+        commands.swap(_queue);
+        lock.unlock();
+
+        // One clock read per wakeup, shared by every command and expiry.
+        auto now = Clock::Now();
+        Clock::Instance().Publish(now);
+        if (!publishing) {
+            Clock::Instance().Attach();
+            publishing = true;
+        }
+
+        for (auto& command : commands) {
+            apply_(command, now);
+        }
+        commands.clear();
+        flush_();
+        reap_();
+
+        resync_(now);
+        _wheel->Advance(tick_(now), _expired);
+        for (auto task : _expired) {
+            fire_(task);
+        }
+        _expired.clear();
+
+        lock.lock();
+    }
+    if (publishing) {
+        Clock::Instance().Detach();
+    }
+}
+
+void WheelWorker::apply_(Command& command, const Clock::TimePoint& now)
+{
+    Task* task = command.task.get();
+    switch (command.type) {
+        case CommandType::Add:
+            task->_self = std::move(command.task);
+            join_wall_(task);
+            join_group_(task);
+            if (task->Cancelled() || !arm_(task, Clock::Instance().ToWall(now))) {
+                finish_(task);
+                break;
+            }
+            task->_preset = false;
+            // Linked in one batch after all commands of this wakeup.
+            _armed.push_back(task);
+            break;
+        case CommandType::CancelGroup:
+            flush_();
+            while (command.group->_head) {
+                task = command.group->_head;
+                task->cancel_();
+                _wheel->Remove(task);
+                finish_(task);
+            }
+            break;
+        case CommandType::ShiftGroup:
+            flush_();
+            for (task = command.group->_head; task; task = task->_group_next) {
+                _wheel->Remove(task);
+                task->_deadline += command.offset;
+                task->_walltime += command.offset;
+                task->_expire = Wheel::Coalesce(expire_tick_(task->_deadline), task->_slack / _accuracy);
+                _wheel->Insert(task);
+            }
+            break;
+    }
+}
+
+bool WheelWorker::arm_(Task* task, const Rule::RefTimePoint& reftime)
+{
+    if (!task->_rule) {
+        task->_walltime = Clock::Instance().ToWall(task->_deadline);
+        task->_expire = expire_tick_(task->_deadline);
+        return true;
+    }
+    // First fire computed before the task was added, unless already passed.
+    if (task->_preset && task->_walltime > reftime) {
+        task->_reftime = reftime;
+        task->_deadline = Clock::Instance().ToSteady(task->_walltime);
+        task->_expire = Wheel::Coalesce(expire_tick_(task->_deadline), task->_slack / _accuracy);
+        return true;
+    }
+    auto ret = task->_rule.GetNextExprieTime(reftime);
+    if (std::get<0>(ret) != Return::SUCCESS) {
+        return false;
+    }
+    task->_reftime = reftime;
+    task->_walltime = std::get<1>(ret);
+    task->_deadline = Clock::Instance().ToSteady(task->_walltime);
+    task->_expire = Wheel::Coalesce(expire_tick_(task->_deadline), task->_slack / _accuracy);
+    return true;
+}
+
+void WheelWorker::fire_(Task* task)
+{
+    if (task->Cancelled()) {
+        finish_(task);
+        return;
+    }
+    // Touched since armed, the task was left in its old slot and only now
+    // moves on to the stored deadline.
+    Clock::TimePoint touched(std::chrono::nanoseconds(task->_touched.load(std::memory_order_relaxed)));
+    if (touched > task->_deadline) {
+        task->_deadline = touched;
+        task->_walltime = Clock::Instance().ToWall(touched);
+        task->_expire = Wheel::Coalesce(expire_tick_(touched), task->_slack / _accuracy);
+        if (task->_expire > _wheel->GetCurrent()) {
+            _wheel->Insert(task);
+            return;
+        }
+    }
+    if (!task->transit_(TaskState::Pending, TaskState::Firing)) {
+        finish_(task);
+        return;
+    }
+    task->_fired = true;
+    if (task->_handle) {
+        finish_(task);
+        return;
+    }
+    task->_callback();
+    // Fails when cancelled while the callback ran.
+    if (!task->_repeat || !task->transit_(TaskState::Firing, TaskState::Pending)) {
+        finish_(task);
+        return;
+    }
+    // Durations continue from the wheel deadline, so a wall clock step in
+    // between does not move them. Wall clock rules continue from wall time.
+    Rule::RefTimePoint reftime = task->_wall ? task->_walltime : Clock::Instance().ToWall(task->_deadline);
+    if (!arm_(task, reftime)) {
+        finish_(task);
+        return;
+    }
+    _wheel->Insert(task);
+}
+
+void WheelWorker::finish_(Task* task)
+{
+    // Unless cancelled, from wherever the task is right now.
+    if (!task->transit_(TaskState::Pending, TaskState::Done)) {
+        task->transit_(TaskState::Firing, TaskState::Done);
+    }
+    leave_wall_(task);
+    leave_group_(task);
+    std::coroutine_handle<> handle = task->_handle;
+    {
+        // Last reference may be the task itself.
+        std::shared_ptr<Task> self = std::move(task->_self);
+    }
+    // The coroutine may destroy the awaiter holding the task, not touched after.
+    if (handle) {
+        handle.resume();
+    }
+}
+
+void WheelWorker::reap_()
+{
+    Task* task = _cancels.exchange(nullptr, std::memory_order_acquire);
+    while (task) {
+        Task* next = task->_cancel_next;
+        std::shared_ptr<Task> ref = std::move(task->_cancel_ref);
+        // Not scheduled any more when already finished at fire or add.
+        if (task->_self) {
+            _wheel->Remove(task);
+            finish_(task);
+        }
+        task = next;
+    }
+}
+
+void WheelWorker::flush_()
+{
+    if (_armed.empty()) {
+        return;
+    }
+    _wheel->InsertBatch(_armed);
+    _armed.clear();
+}
+
+void WheelWorker::resync_(const Clock::TimePoint& now)
+{
+    if (now < _resync_time) {
+        return;
+    }
+    _resync_time = now + TIMER_CLOCK_RESYNC_INTERVAL;
+    Clock::Instance().Resync();
+    if (_generation == Clock::Instance().GetGeneration()) {
+        return;
+    }
+    _generation = Clock::Instance().GetGeneration();
+
+    if (_step_generation == Clock::Instance().GetStepGeneration()) {
+        // Offset drifted, the same fire times only move on the wheel.
+        for (Task* task = _wall_head; task; task = task->_wall_next) {
+            _wheel->Remove(task);
+            task->_deadline = Clock::Instance().ToSteady(task->_walltime);
+            task->_expire = Wheel::Coalesce(expire_tick_(task->_deadline), task->_slack / _accuracy);
+            _wheel->Insert(task);
+        }
+        return;
+    }
+    _step_generation = Clock::Instance().GetStepGeneration();
+
+    // Wall clock stepped, re-arm wall clock tasks from the new wall time.
+    // Fire times skipped by a forward step are dropped instead of firing at
+    // once, a backward step never repeats a fire already done.
+    Rule::RefTimePoint wall = Clock::Instance().ToWall(now);
+    size_t count = _wall_size;
+    for (Task* task = _wall_head, *next = nullptr; task; task = next) {
+        // A failed re-arm unlinks the task.
+        next = task->_wall_next;
+        _wheel->Remove(task);
+        if (!arm_(task, std::max(task->_reftime, wall))) {
+            finish_(task);
+            continue;
+        }
+        _wheel->Insert(task);
+    }
+    TIMER_WHEEL_INFO("Re-armed [", count, "] wall clock tasks");
+}
+
+void WheelWorker::join_group_(Task* task)
+{
+    TimerGroup* group = task->_group.get();
+    if (!group) {
+        return;
+    }
+    task->_group_prev = nullptr;
+    task->_group_next = group->_head;
+    if (group->_head) {
+        group->_head->_group_prev = task;
+    }
+    group->_head = task;
+    group->_size.fetch_add(1, std::memory_order_relaxed);
+}
+
+void WheelWorker::leave_group_(Task* task)
+{
+    TimerGroup* group = task->_group.get();
+    if (!group || (group->_head != task && !task->_group_prev)) {
+        return;
+    }
+    if (task->_group_prev) {
+        task->_group_prev->_group_next = task->_group_next;
+    } else {
+        group->_head = task->_group_next;
+    }
+    if (task->_group_next) {
+        task->_group_next->_group_prev = task->_group_prev;
+    }
+    task->_group_prev = nullptr;
+    task->_group_next = nullptr;
+    group->_size.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void WheelWorker::join_wall_(Task* task)
+{
+    if (!task->_wall) {
+        return;
+    }
+    task->_wall_prev = nullptr;
+    task->_wall_next = _wall_head;
+    if (_wall_head) {
+        _wall_head->_wall_prev = task;
+    }
+    _wall_head = task;
+    ++_wall_size;
+}
+
+void WheelWorker::leave_wall_(Task* task)
+{
+    if (_wall_head != task && !task->_wall_prev) {
+        return;
+    }
+    if (task->_wall_prev) {
+        task->_wall_prev->_wall_next = task->_wall_next;
+    } else {
+        _wall_head = task->_wall_next;
+    }
+    if (task->_wall_next) {
+        task->_wall_next->_wall_prev = task->_wall_prev;
+    }
+    task->_wall_prev = nullptr;
+    task->_wall_next = nullptr;
+    --_wall_size;
+}
+
+}
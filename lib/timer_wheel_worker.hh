@@ -1,12 +1,175 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-17 09:15
+ * @file     : timer_wheel_worker.hh
+ * @brief    : Thread driving one timer wheel.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
 #ifndef __TIMER_WHEEL_WORKER_HH__
 #define __TIMER_WHEEL_WORKER_HH__
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "timer_return.hh"
+#include "timer_clock.hh"
+#include "timer_wheel_geometry.hh"
+#include "timer_wheel.hh"
+#include "timer_group.hh"
+
+// Interval between wall clock offset samples.
+#define TIMER_CLOCK_RESYNC_INTERVAL (std::chrono::seconds(1))
+// Submission queue capacity allocated by the worker thread itself.
+#define TIMER_WORKER_QUEUE_RESERVE (1024)
+
 namespace xg::timer {
 
+/**
+* @brief - Wheel worker, one thread owning one wheel (a shard).
+*          Other threads only post commands to the submission queue, the
+*          wheel itself is touched by the worker thread alone. Callbacks
+*          run on the worker thread.
+*          With an affinity set, the thread pins itself first and only then
+*          allocates its wheel and queues, placing them on its NUMA node by
+*          first touch.
+*/
 class WheelWorker {
+public:
+    WheelWorker(const WheelGeometry& geometry);
+    ~WheelWorker();
+
+    Return Start();
+    Return Stop();
+    bool Running();
+
+    /**
+    * @brief SetAffinity - Cpus the worker thread is pinned to.
+    *
+    * @param [cpus] - Cpu ids, empty for no pinning.
+    *
+    * @returns  Return class, fails once the worker was started.
+    */
+    Return SetAffinity(const std::vector<int>& cpus);
+
+    /**
+    * @brief GetNode - NUMA node the worker is pinned to, 0 when unpinned.
+    */
+    int GetNode() const {
+        return _node;
+    }
+
+    /**
+    * @brief Add - Post a task to be armed on this worker.
+    *
+    * @param [task] - New task, not scheduled on any worker.
+    *
+    * @returns  Return class.
+    */
+    Return Add(std::shared_ptr<Task> task);
+
+    /**
+    * @brief AddBatch - Post many tasks with one queue submission.
+    *
+    * @param [tasks] - New tasks, not scheduled on any worker, moved from.
+    *
+    * @returns  Return class, on error no task is posted.
+    */
+    Return AddBatch(std::vector<std::shared_ptr<Task>>& tasks);
+
+    /**
+    * @brief Cancel - Cancel a task, it will not fire once this returns.
+    *                 Lock free: the task is pushed on a lock free stack and
+    *                 unlinked on the worker's next wakeup. A callback running
+    *                 at this moment completes but is not run again.
+    *
+    * @param [task] - Task added to this worker.
+    *
+    * @returns  Return class.
+    */
+    Return Cancel(std::shared_ptr<Task> task);
+
+    /**
+    * @brief CancelGroup - Cancel every member of a group, none fires once
+    *                      this returns.
+    *
+    * @param [group] - Group bound to this worker.
+    *
+    * @returns  Return class.
+    */
+    Return CancelGroup(std::shared_ptr<TimerGroup> group);
+
+    /**
+    * @brief ShiftGroup - Move the next fire of every member of a group.
+    *
+    * @param [group] - Group bound to this worker.
+    * @param [offset] - Added to each member's deadline, may be negative.
+    *
+    * @returns  Return class.
+    */
+    Return ShiftGroup(std::shared_ptr<TimerGroup> group, std::chrono::nanoseconds offset);
+
+private:
+    enum class CommandType {
+        Add,
+        CancelGroup,
+        ShiftGroup,
+    };
+    struct Command {
+        CommandType type;
+        std::shared_ptr<Task> task;
+        std::shared_ptr<TimerGroup> group;
+        std::chrono::nanoseconds offset;
+    };
+
+    long long tick_(const Clock::TimePoint& time) const {
+        return time.time_since_epoch().count() / _accuracy.count();
+    }
+    long long expire_tick_(const Clock::TimePoint& time) const {
+        return (time.time_since_epoch().count() + _accuracy.count() - 1) / _accuracy.count();
+    }
+
+    Return post_(Command&& command);
+    void run_();
+    void apply_(Command& command, const Clock::TimePoint& now);
+    bool arm_(Task* task, const Rule::RefTimePoint& reftime);
+    void fire_(Task* task);
+    void finish_(Task* task);
+    void resync_(const Clock::TimePoint& now);
+    void reap_();
+    void flush_();
+    void join_group_(Task* task);
+    void leave_group_(Task* task);
+    void join_wall_(Task* task);
+    void leave_wall_(Task* task);
+
+private:
+    std::chrono::nanoseconds _accuracy;
+    WheelGeometry _geometry;
+    std::vector<int> _cpus;
+    int _node;
+    std::unique_ptr<Wheel> _wheel;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::condition_variable _ready;
+    std::vector<Command> _queue;
+    bool _running;
 
+    std::atomic<Task*> _cancels;        // cancelled tasks, lock free stack
+    std::vector<Task*> _armed;          // added this wakeup, not linked yet
+    std::vector<Task*> _expired;
+    Task* _wall_head;                   // wall clock tasks, linked through the tasks
+    size_t _wall_size;
+    unsigned long _generation;
+    unsigned long _step_generation;
+    Clock::TimePoint _resync_time;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,385 @@
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <map>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+
+#include "timer_log.hh"
+#include "timer_zone.hh"
+
+namespace xg::timer {
+
+namespace {
+
+long long read_big_endian(const unsigned char* data, int bytes)
+{
+    unsigned long long value = 0;
+    for (int index = 0; index < bytes; ++index) {
+        value = (value << 8) | data[index];
+    }
+    if (bytes < 8 && (value >> (bytes * 8 - 1))) {
+        value |= (~0ULL << (bytes * 8));
+    }
+    return (long long)value;
+}
+
+long long days_seconds(const std::chrono::sys_days& days)
+{
+    return (long long)days.time_since_epoch().count() * 86400;
+}
+
+}
+
+Zone::Zone(const std::string& name)
+        : _valid(false), _name(name), _initial_offset(0), _table_end(LLONG_MAX), _has_rule(false), _rule()
+{
+    if (name.empty() || name[0] == '/' || name.find("..") != std::string::npos) {
+        TIMER_RULE_ERROR("Zone name[", name, "] invalid");
+        return;
+    }
+    const char* dir = std::getenv("TZDIR");
+    _valid = load_(std::string(dir ? dir : TIMER_ZONE_DIR) + "/" + name);
+    if (!_valid) {
+        TIMER_RULE_ERROR("Load zone[", name, "] failed");
+        return;
+    }
+    expand_(TIMER_ZONE_MIN_YEAR, TIMER_ZONE_MAX_YEAR);
+}
+
+Zone::~Zone() { }
+
+std::shared_ptr<const Zone> Zone::Locate(const std::string& name)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const Zone>> zones;
+
+    std::scoped_lock lock(mutex);
+    auto zone_it = zones.find(name);
+    if (zone_it != zones.end()) {
+        return zone_it->second;
+    }
+    auto zone = std::make_shared<const Zone>(name);
+    zones.insert({name, zone});
+    return zone;
+}
+
+bool Zone::Valid() const
+{
+    return _valid;
+}
+
+const std::string& Zone::GetName() const
+{
+    return _name;
+}
+
+bool Zone::load_(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 44 || std::memcmp(data.data(), "TZif", 4) != 0) {
+        return false;
+    }
+
+    // RFC 8536, the version 2+ block repeats the data with 64-bit times.
+    auto parse_block = [&](size_t pos, int time_size, size_t& end) -> bool {
+        if (pos + 44 > data.size()) {
+            return false;
+        }
+        const unsigned char* header = data.data() + pos + 20;
+        size_t isutcnt = read_big_endian(header, 4);
+        size_t isstdcnt = read_big_endian(header + 4, 4);
+        size_t leapcnt = read_big_endian(header + 8, 4);
+        size_t timecnt = read_big_endian(header + 12, 4);
+        size_t typecnt = read_big_endian(header + 16, 4);
+        size_t charcnt = read_big_endian(header + 20, 4);
+        size_t body = pos + 44;
+        end = body + timecnt * time_size + timecnt + typecnt * 6 + charcnt
+                + leapcnt * (time_size + 4) + isstdcnt + isutcnt;
+        if (typecnt == 0 || end > data.size()) {
+            return false;
+        }
+        const unsigned char* times = data.data() + body;
+        const unsigned char* indexes = times + timecnt * time_size;
+        const unsigned char* types = indexes + timecnt;
+
+        _transitions.clear();
+        _initial_offset = (int)read_big_endian(types, 4);
+        int prev_offset = _initial_offset;
+        for (size_t index = 0; index < timecnt; ++index) {
+            if (indexes[index] >= typecnt) {
+                return false;
+            }
+            int offset = (int)read_big_endian(types + indexes[index] * 6, 4);
+            if (offset == prev_offset) {
+                continue;
+            }
+            _transitions.push_back({read_big_endian(times + index * time_size, time_size), offset});
+            prev_offset = offset;
+        }
+        return true;
+    };
+
+    size_t end = 0;
+    if (!parse_block(0, 4, end)) {
+        return false;
+    }
+    if (data[4] >= '2') {
+        if (!parse_block(end, 8, end)) {
+            return false;
+        }
+        if (end < data.size() && data[end] == '\n') {
+            auto footer_end = std::find(data.begin() + end + 1, data.end(), '\n');
+            std::string footer(data.begin() + end + 1, footer_end);
+            if (!footer.empty()) {
+                _has_rule = parse_posix_(footer);
+            }
+        }
+    }
+    return true;
+}
+
+bool Zone::parse_posix_(const std::string& tz)
+{
+    size_t pos = 0;
+    auto parse_name = [&]() -> bool {
+        size_t begin = pos;
+        if (pos < tz.size() && tz[pos] == '<') {
+            pos = tz.find('>', pos);
+            if (pos == std::string::npos) {
+                return false;
+            }
+            ++pos;
+            return true;
+        }
+        while (pos < tz.size() && std::isalpha((unsigned char)tz[pos])) {
+            ++pos;
+        }
+        return (pos - begin >= 3);
+    };
+    auto parse_number = [&](int& number) -> bool {
+        size_t begin = pos;
+        number = 0;
+        while (pos < tz.size() && std::isdigit((unsigned char)tz[pos])) {
+            number = number * 10 + (tz[pos++] - '0');
+        }
+        return (pos > begin);
+    };
+    auto parse_time = [&](int& seconds) -> bool {
+        int sign = 1;
+        if (pos < tz.size() && (tz[pos] == '+' || tz[pos] == '-')) {
+            sign = (tz[pos++] == '-') ? -1 : 1;
+        }
+        int hours = 0, minutes = 0, secs = 0;
+        if (!parse_number(hours)) {
+            return false;
+        }
+        if (pos < tz.size() && tz[pos] == ':') {
+            ++pos;
+            if (!parse_number(minutes)) return false;
+            if (pos < tz.size() && tz[pos] == ':') {
+                ++pos;
+                if (!parse_number(secs)) return false;
+            }
+        }
+        seconds = sign * (hours * 3600 + minutes * 60 + secs);
+        return true;
+    };
+    auto parse_date = [&](PosixRule::Date& date) -> bool {
+        date.month = date.week = date.day = 0;
+        date.time = 7200;
+        if (pos >= tz.size()) {
+            return false;
+        }
+        if (tz[pos] == 'M') {
+            ++pos;
+            date.type = PosixRule::DateType::MonthWeek;
+            if (!parse_number(date.month) || pos >= tz.size() || tz[pos++] != '.'
+                    || !parse_number(date.week) || pos >= tz.size() || tz[pos++] != '.'
+                    || !parse_number(date.day)) {
+                return false;
+            }
+            if (date.month < 1 || date.month > 12 || date.week < 1 || date.week > 5 || date.day > 6) {
+                return false;
+            }
+        } else if (tz[pos] == 'J') {
+            ++pos;
+            date.type = PosixRule::DateType::Julian;
+            if (!parse_number(date.day) || date.day < 1 || date.day > 365) {
+                return false;
+            }
+        } else {
+            date.type = PosixRule::DateType::Zero;
+            if (!parse_number(date.day) || date.day > 365) {
+                return false;
+            }
+        }
+        if (pos < tz.size() && tz[pos] == '/') {
+            ++pos;
+            return parse_time(date.time);
+        }
+        return true;
+    };
+
+    int offset = 0;
+    if (!parse_name() || !parse_time(offset)) {
+        return false;
+    }
+    // POSIX offsets are positive west of Greenwich.
+    _rule.std_offset = -offset;
+    _rule.dst = false;
+    if (pos >= tz.size()) {
+        return true;
+    }
+    if (!parse_name()) {
+        return false;
+    }
+    _rule.dst = true;
+    _rule.dst_offset = _rule.std_offset + 3600;
+    if (pos < tz.size() && tz[pos] != ',') {
+        if (!parse_time(offset)) {
+            return false;
+        }
+        _rule.dst_offset = -offset;
+    }
+    if (pos >= tz.size() || tz[pos++] != ',' || !parse_date(_rule.start)
+            || pos >= tz.size() || tz[pos++] != ',' || !parse_date(_rule.end)) {
+        return false;
+    }
+    return (pos == tz.size());
+}
+
+long long Zone::rule_date_(const PosixRule::Date& date, int year) const
+{
+    using namespace std::chrono;
+    sys_days days = std::chrono::year(year) / January / 1;
+    switch (date.type) {
+        case PosixRule::DateType::Julian:
+            days += std::chrono::days(date.day - 1);
+            if (std::chrono::year(year).is_leap() && date.day >= 60) {
+                days += std::chrono::days(1);
+            }
+            break;
+        case PosixRule::DateType::Zero:
+            days += std::chrono::days(date.day);
+            break;
+        case PosixRule::DateType::MonthWeek:
+            if (date.week == 5) {
+                days = year_month_weekday_last(std::chrono::year(year), std::chrono::month(date.month),
+                                               weekday_last(weekday(date.day)));
+            } else {
+                days = year_month_weekday(std::chrono::year(year), std::chrono::month(date.month),
+                                          weekday_indexed(weekday(date.day), date.week));
+            }
+            break;
+    }
+    return days_seconds(days) + date.time;
+}
+
+void Zone::expand_(int year_begin, int year_end)
+{
+    if (!_has_rule || !_rule.dst) {
+        return;
+    }
+    long long last = _transitions.empty() ? LLONG_MIN : _transitions.back().utc;
+    for (int year = year_begin; year <= year_end; ++year) {
+        Transition start = {rule_date_(_rule.start, year) - _rule.std_offset, _rule.dst_offset};
+        Transition end = {rule_date_(_rule.end, year) - _rule.dst_offset, _rule.std_offset};
+        if (end.utc < start.utc) {
+            std::swap(start, end);
+        }
+        for (auto& transition : {start, end}) {
+            if (transition.utc <= last) {
+                continue;
+            }
+            int prev_offset = _transitions.empty() ? _initial_offset : _transitions.back().offset;
+            if (transition.offset != prev_offset) {
+                _transitions.push_back(transition);
+            }
+            last = transition.utc;
+        }
+    }
+    _table_end = std::max(days_seconds(std::chrono::year(year_end + 1) / std::chrono::January / 1), last);
+}
+
+int Zone::offset_by_rule_(long long utc) const
+{
+    if (!_rule.dst) {
+        return _rule.std_offset;
+    }
+    std::chrono::sys_days days(std::chrono::days((utc + _rule.std_offset) / 86400));
+    int year = (int)std::chrono::year_month_day(days).year();
+    long long start = rule_date_(_rule.start, year) - _rule.std_offset;
+    long long end = rule_date_(_rule.end, year) - _rule.dst_offset;
+    if (start < end) {
+        return (utc >= start && utc < end) ? _rule.dst_offset : _rule.std_offset;
+    }
+    return (utc >= end && utc < start) ? _rule.std_offset : _rule.dst_offset;
+}
+
+int Zone::offset_(long long utc) const
+{
+    if (utc >= _table_end && _has_rule) {
+        return offset_by_rule_(utc);
+    }
+    auto transition_it = std::upper_bound(_transitions.begin(), _transitions.end(), utc,
+            [](long long value, const Transition& transition) { return value < transition.utc; });
+    if (transition_it == _transitions.begin()) {
+        return _initial_offset;
+    }
+    return std::prev(transition_it)->offset;
+}
+
+int Zone::GetOffset(const Rule::RefTimePoint& utc) const
+{
+    return offset_(std::chrono::floor<std::chrono::seconds>(utc).time_since_epoch().count());
+}
+
+Rule::RefTimePoint Zone::ToLocal(const Rule::RefTimePoint& utc) const
+{
+    return utc + std::chrono::seconds(GetOffset(utc));
+}
+
+std::tuple<Return, Rule::RefTimePoint>
+Zone::ToUTC(const Rule::RefTimePoint& local, const Rule::RefTimePoint& reftime) const
+{
+    auto local_seconds = std::chrono::floor<std::chrono::seconds>(local);
+    auto subseconds = local - local_seconds;
+    long long wall = local_seconds.time_since_epoch().count();
+
+    // Offsets in effect a day before and after cover any single transition.
+    long long before = wall - offset_(wall - 86400);
+    long long after = wall - offset_(wall + 86400);
+    std::array<long long, 2> candidates;
+    size_t count = 0;
+    if (offset_(before) == wall - before) {
+        candidates[count++] = before;
+    }
+    if (after != before && offset_(after) == wall - after) {
+        candidates[count++] = after;
+    }
+    if (!count) {
+        candidates[count++] = before;
+    }
+    if (count == 2 && candidates[1] < candidates[0]) {
+        std::swap(candidates[0], candidates[1]);
+    }
+    for (size_t index = 0; index < count; ++index) {
+        long long candidate = candidates[index];
+        Rule::RefTimePoint utc = Rule::RefTimePoint(std::chrono::seconds(candidate)) + subseconds;
+        if (utc > reftime) {
+            return {Return::SUCCESS, utc};
+        }
+    }
+    return {Return::ERROR, reftime};
+}
+
+}
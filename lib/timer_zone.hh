@@ -0,0 +1,126 @@
+/*******************************************************
+ * Copyright (C) For free.
+ * All rights reserved.
+ *******************************************************
+ * @author   : Ronghua Gao
+ * @date     : 2022-05-12 16:05
+ * @file     : timer_zone.hh
+ * @brief    : Time zone with precomputed UTC offset transitions.
+ * @note     : Email - grh4542681@163.com
+ * ******************************************************/
+#ifndef __TIMER_ZONE_HH__
+#define __TIMER_ZONE_HH__
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "timer_return.hh"
+#include "timer_rule.hh"
+
+#define TIMER_ZONE_DIR "/usr/share/zoneinfo"
+#define TIMER_ZONE_MIN_YEAR (1970)
+#define TIMER_ZONE_MAX_YEAR (2100)
+
+namespace xg::timer {
+
+/**
+* @brief - IANA time zone loaded from the system TZif database.
+*          All UTC offset transitions between TIMER_ZONE_MIN_YEAR and
+*          TIMER_ZONE_MAX_YEAR are expanded once on load, lookups are a
+*          binary search in that table. Later years fall back to the
+*          POSIX rule of the zone file.
+*          Local times are carried in RefTimePoint as if they were UTC.
+*/
+class Zone {
+public:
+    /**
+    * @brief - UTC offset in effect from a UTC instant on.
+    */
+    struct Transition {
+        long long utc;
+        int offset;
+    };
+
+    /**
+    * @brief - POSIX TZ rule, used past the end of the transition table.
+    */
+    struct PosixRule {
+        enum class DateType {
+            Julian,     // Jn, 1..365, February 29 never counted
+            Zero,       // n, 0..365
+            MonthWeek,  // Mm.w.d
+        };
+        struct Date {
+            DateType type;
+            int month;
+            int week;
+            int day;
+            int time;
+        };
+        bool dst;
+        int std_offset;
+        int dst_offset;
+        Date start;
+        Date end;
+    };
+
+public:
+    Zone(const std::string& name);
+    ~Zone();
+
+    /**
+    * @brief Locate - Get a loaded zone, each zone is loaded once per process.
+    *
+    * @param [name] - IANA zone name, e.g. "Europe/Berlin".
+    *
+    * @returns  Shared zone, check Valid().
+    */
+    static std::shared_ptr<const Zone> Locate(const std::string& name);
+
+    bool Valid() const;
+    const std::string& GetName() const;
+
+    /**
+    * @brief GetOffset - UTC offset in seconds at a UTC time.
+    */
+    int GetOffset(const Rule::RefTimePoint& utc) const;
+
+    /**
+    * @brief ToLocal - Convert UTC time to local time.
+    */
+    Rule::RefTimePoint ToLocal(const Rule::RefTimePoint& utc) const;
+
+    /**
+    * @brief ToUTC - Convert local time to the earliest UTC time after reftime.
+    *                A local time skipped by a forward transition maps to
+    *                the same wall time in the offset before the transition.
+    *
+    * @param [local] - Local time.
+    * @param [reftime] - Result must be after this UTC time.
+    *
+    * @returns  Tuple of Return class & UTC time.
+    */
+    std::tuple<Return, Rule::RefTimePoint> ToUTC(const Rule::RefTimePoint& local, const Rule::RefTimePoint& reftime) const;
+
+private:
+    bool load_(const std::string& path);
+    bool parse_posix_(const std::string& tz);
+    void expand_(int year_begin, int year_end);
+    long long rule_date_(const PosixRule::Date& date, int year) const;
+    int offset_by_rule_(long long utc) const;
+    int offset_(long long utc) const;
+
+private:
+    bool _valid;
+    std::string _name;
+    int _initial_offset;
+    long long _table_end;
+    bool _has_rule;
+    PosixRule _rule;
+    std::vector<Transition> _transitions;
+};
+
+}
+
+#endif
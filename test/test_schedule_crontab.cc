@@ -1,6 +1,8 @@
 #include <algorithm>
+#include <thread>
 #include "timer_log.hh"
 #include "timer_rule_crontab.hh"
+#include "timer_rule_crontab_literal.hh"
 
 using namespace std::chrono_literals;
 
@@ -9,9 +11,160 @@ int main()
     xg::timer::RuleCrontab sc("*/45,2022,2022-2032,2032-2042/3 1 20 4 1 1 30");
     auto t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
     xg::timer::Log::Info("TEST", std::put_time(std::gmtime(&t), "%F %T"));
-    t = std::chrono::system_clock::to_time_t(std::get<1>(sc.GetNextExprieTime()));
+    auto first = std::get<1>(sc.GetNextExprieTime());
+    t = std::chrono::system_clock::to_time_t(first);
     xg::timer::Log::Info("TEST", std::put_time(std::gmtime(&t), "%F %T"));
-    t = std::chrono::system_clock::to_time_t(std::get<1>(sc.GetNextExprieTime()));
+    t = std::chrono::system_clock::to_time_t(std::get<1>(sc.GetNextExprieTime(std::move(first))));
     xg::timer::Log::Info("TEST", std::put_time(std::gmtime(&t), "%F %T"));
+
+    xg::timer::RuleCrontab leap(std::chrono::sys_days(2022y/2/27), "2023-2030 2 29 * 0 0 0");
+    auto next = std::get<1>(leap.GetNextExprieTime());
+    t = std::chrono::system_clock::to_time_t(next);
+    xg::timer::Log::Info("TEST", std::put_time(std::gmtime(&t), "%F %T"));
+    if (next != std::chrono::sys_days(2024y/2/29)) {
+        xg::timer::Log::Error("TEST", "leap day rule mismatch");
+        return 1;
+    }
+
+    // Extended syntax, each rule from 2024-06-01 00:00:00.
+    std::vector<std::pair<std::string, std::chrono::sys_days>> extends = {
+        {"* * L * 0 0 0", 2024y/6/30},
+        {"* * L-3 * 0 0 0", 2024y/6/27},
+        {"* * 15W * 0 0 0", 2024y/6/14},
+        {"* * 1W * 0 0 0", 2024y/6/3},
+        {"* * LW * 0 0 0", 2024y/6/28},
+        {"* * ? 5#3 0 0 0", 2024y/6/21},
+        {"* * ? FRIL 0 0 0", 2024y/6/28},
+        {"* AUG,DEC 1 * 0 0 0", 2024y/8/1},
+        {"* * ? SAT-SUN 0 0 0", 2024y/6/2},
+        {"* * 2/10 * 0 0 0", 2024y/6/2},
+    };
+    for (auto& extend : extends) {
+        xg::timer::RuleCrontab rule(std::chrono::sys_days(2024y/6/1), extend.first);
+        next = std::get<1>(rule.GetNextExprieTime());
+        t = std::chrono::system_clock::to_time_t(next);
+        xg::timer::Log::Info("TEST", extend.first, " -> ", std::put_time(std::gmtime(&t), "%F %T"));
+        if (next != extend.second) {
+            xg::timer::Log::Error("TEST", "extended rule mismatch");
+            return 1;
+        }
+    }
+
+    // Known to never fire again, without walking up to the year limit.
+    for (auto never : {"2020-2023 * * * * * *", "* 4,6,9,11 31 * 0 0 0", "2021-2023 2 29 * 0 0 0"}) {
+        xg::timer::RuleCrontab rule(std::chrono::sys_days(2024y/6/1), never);
+        if (std::get<0>(rule.GetNextExprieTime()) != xg::timer::Return::ESCHEDULE_RULE_REACH_LIMIT) {
+            xg::timer::Log::Error("TEST", "rule[", never, "] should reach limit");
+            return 1;
+        }
+    }
+
+    // 09:00 New York time, across the 2024-03-10 DST change.
+    xg::timer::RuleCrontab local(std::chrono::sys_days(2024y/3/9), "* * * * 9 0 0", "America/New_York");
+    next = local.GetStartTime();
+    for (auto expect : {std::chrono::sys_days(2024y/3/9) + 14h, std::chrono::sys_days(2024y/3/10) + 13h}) {
+        next = std::get<1>(local.GetNextExprieTime(std::move(next)));
+        t = std::chrono::system_clock::to_time_t(next);
+        xg::timer::Log::Info("TEST", std::put_time(std::gmtime(&t), "%F %T"));
+        if (next != expect) {
+            xg::timer::Log::Error("TEST", "zone rule mismatch");
+            return 1;
+        }
+    }
+
+    // Wheel scale, ticks have to divide a second and round up.
+    xg::timer::RuleCrontab daily(std::chrono::sys_days(2024y/6/1), "* * * * 9 0 0");
+    xg::timer::WheelAccuracy fine(1ms);
+    xg::timer::WheelAccuracy odd(7ms);
+    if (!daily.Valid(fine) || daily.Valid(odd)) {
+        xg::timer::Log::Error("TEST", "crontab accuracy check mismatch");
+        return 1;
+    }
+    auto scale = daily.GetNextExprieScale(std::chrono::sys_days(2024y/6/1) + 8h + 500us, fine);
+    if (std::get<0>(scale) != xg::timer::Return::SUCCESS || std::get<1>(scale).GetNum() != 3600 * 1000) {
+        xg::timer::Log::Error("TEST", "crontab scale mismatch [", std::get<1>(scale).GetNum(), "]");
+        return 1;
+    }
+
+    // One const rule walked by several threads, each keeping its own cursor.
+    const xg::timer::RuleCrontab shared(std::chrono::sys_days(2024y/1/1), "* * ? MON-FRI 9 30 0", "Asia/Shanghai");
+    std::vector<xg::timer::Rule::RefTimePoint> expects(1, shared.GetStartTime());
+    for (int index = 0; index < 200; ++index) {
+        expects.push_back(std::get<1>(shared.GetNextExprieTime(xg::timer::Rule::RefTimePoint(expects.back()))));
+    }
+    std::atomic<int> mismatch(0);
+    std::vector<std::thread> walkers;
+    for (int thread = 0; thread < 4; ++thread) {
+        walkers.emplace_back([&]() {
+            for (int round = 0; round < 20; ++round) {
+                auto cursor = shared.GetStartTime();
+                for (size_t index = 1; index < expects.size(); ++index) {
+                    cursor = std::get<1>(shared.GetNextExprieTime(std::move(cursor)));
+                    if (cursor != expects[index]) {
+                        ++mismatch;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : walkers) {
+        thread.join();
+    }
+    if (mismatch) {
+        xg::timer::Log::Error("TEST", "shared rule walk mismatch [", mismatch.load(), "]");
+        return 1;
+    }
+
+    // Queries inside the last searched window answer from the memo, and
+    // agree with a search. The reset rule is moved off its window first.
+    // Steps running past the field are rejected, not walked.
+    for (auto bad : {"* * * * * * 59/2147483647", "* * * * * * 59/2", "* 1/2147483647 * * * * *",
+                     "99999999999 * * * * * *", "* * * * * * 1-99999999999"}) {
+        if (xg::timer::RuleCrontab(bad).Parsed()) {
+            xg::timer::Log::Error("TEST", "rule[", bad, "] should not parse");
+            return 1;
+        }
+    }
+    xg::timer::RuleCrontab memo(std::chrono::sys_days(2024y/1/1), "* * * * */2 5,35 0");
+    xg::timer::RuleCrontab reset(std::chrono::sys_days(2024y/1/1), "* * * * */2 5,35 0");
+    for (int index = 0; index < 2000; ++index) {
+        xg::timer::Rule::RefTimePoint reftime = std::chrono::sys_days(2024y/1/1) + std::chrono::seconds(index * 97) + 123ms;
+        auto cached = memo.GetNextExprieTime(xg::timer::Rule::RefTimePoint(reftime));
+        reset.GetNextExprieTime(std::chrono::sys_days(2030y/1/1));
+        auto searched = reset.GetNextExprieTime(std::move(reftime));
+        if (std::get<1>(cached) != std::get<1>(searched)) {
+            xg::timer::Log::Error("TEST", "memoized next fire mismatch at [", index, "]");
+            return 1;
+        }
+    }
+
+    // Literals compiled at build time match the runtime parser.
+    auto same = [](const std::shared_ptr<xg::timer::RuleCrontab>& literal, std::string text) {
+        xg::timer::RuleCrontab parsed(text);
+        if (!literal->Parsed() || literal->IsDayUnion() != parsed.IsDayUnion() || literal->HasDaySpecial() != parsed.HasDaySpecial()) {
+            return false;
+        }
+        for (int field = xg::timer::RuleCrontab::Field::Begin; field <= xg::timer::RuleCrontab::Field::End; ++field) {
+            auto index = (xg::timer::RuleCrontab::Field)field;
+            if (literal->GetFieldMask(index) != parsed.GetFieldMask(index)) {
+                return false;
+            }
+        }
+        xg::timer::Rule::RefTimePoint from = std::chrono::sys_days(2024y/6/1);
+        return std::get<1>(literal->GetNextExprieTime(xg::timer::Rule::RefTimePoint(from))) == std::get<1>(parsed.GetNextExprieTime(std::move(from)));
+    };
+    if (!same(xg::timer::Crontab<"*/45,2022,2022-2032,2032-2042/3 1 20 4 1 1 30">(), "*/45,2022,2022-2032,2032-2042/3 1 20 4 1 1 30")
+            || !same(xg::timer::Crontab<"* jan-Mar/2,AUG 1 * 0 0 0">(), "* jan-Mar/2,AUG 1 * 0 0 0")
+            || !same(xg::timer::Crontab<"* * L-3,15W,LW * 0 0 0">(), "* * L-3,15W,LW * 0 0 0")
+            || !same(xg::timer::Crontab<"* * ? 5#3,FRIL,SAT-SUN 0 0 0">(), "* * ? 5#3,FRIL,SAT-SUN 0 0 0")
+            || !same(xg::timer::Crontab<"*  *  2/10 MON 0-23/6 */15 0">(), "*  *  2/10 MON 0-23/6 */15 0")) {
+        xg::timer::Log::Error("TEST", "crontab literal mismatch");
+        return 1;
+    }
+    auto zoned = xg::timer::Crontab<"* * * * 9 0 0">("America/New_York");
+    if (std::get<1>(zoned->GetNextExprieTime(std::chrono::sys_days(2024y/3/10))) != std::chrono::sys_days(2024y/3/10) + 13h) {
+        xg::timer::Log::Error("TEST", "zoned crontab literal mismatch");
+        return 1;
+    }
     return 0;
 }
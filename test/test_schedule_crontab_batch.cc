@@ -0,0 +1,56 @@
+#include <algorithm>
+#include "timer_log.hh"
+#include "timer_rule_crontab_batch.hh"
+
+using namespace std::chrono_literals;
+
+int main()
+{
+    std::vector<std::string> rules = {
+        "* * * * * * *",
+        "* * * * * */5 0",
+        "2022-2030 1-6 1,15 * 8-18 0 0",
+        "* * 20 4 1 1 30",
+        "* 2 29 * 0 0 0",
+        "2020 * * * * * *",
+        "* * L-2 * * * *",
+        "* JAN-MAR LW * * * *",
+        "* * 15W,L * * * *",
+        "* * ? 5#3 * * *",
+        "* * * SUNL * * *",
+        "* * 1 MON-FRI * * *",
+    };
+    std::vector<xg::timer::RuleCrontab*> crontabs;
+    xg::timer::RuleCrontabBatch batch;
+    for (auto& rule : rules) {
+        crontabs.push_back(new xg::timer::RuleCrontab(rule));
+        batch.Add(*crontabs.back());
+    }
+
+    // Matched as UTC, a zoned rule is refused rather than fired off by its offset.
+    xg::timer::RuleCrontab zoned("* * * * 12 0 0", "Asia/Shanghai");
+    if (std::get<0>(batch.Add(zoned)) != xg::timer::Return::ESCHEDULE_RULE_INVALID) {
+        xg::timer::Log::Error("TEST", "zoned rule accepted by the batch");
+        return 1;
+    }
+
+    int mismatch = 0;
+    xg::timer::Rule::RefTimePoint time = std::chrono::sys_days(2024y/1/1);
+    for (int step = 0; step < 200000; ++step) {
+        time += 997s;
+        auto& bitmap = batch.Match(xg::timer::Rule::RefTimePoint(time));
+        for (size_t index = 0; index < crontabs.size(); ++index) {
+            auto next = crontabs[index]->GetNextExprieTime(time - 1s);
+            bool fire = (std::get<0>(next) == xg::timer::Return::SUCCESS && std::get<1>(next) == time);
+            if (fire != xg::timer::RuleCrontabBatch::Test(bitmap, index)) {
+                ++mismatch;
+            }
+        }
+    }
+    xg::timer::Log::Info("TEST", "batch mismatch [", mismatch, "]");
+
+    for (auto crontab : crontabs) {
+        delete crontab;
+    }
+    return (mismatch == 0 ? 0 : 1);
+}
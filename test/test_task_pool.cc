@@ -0,0 +1,114 @@
+#include <new>
+#include <cstdlib>
+#include "timer_log.hh"
+#include "timer_rule_duration.hh"
+#include "timer_rule_crontab.hh"
+#include "timer_task_pool.hh"
+#include "timer_wheel_manager.hh"
+
+using namespace std::chrono_literals;
+
+// Counts allocations made by the scheduling thread only.
+static thread_local bool counting = false;
+static thread_local long allocations = 0;
+// Counts allocations made by any thread, workers included.
+static std::atomic<bool> counting_all(false);
+static std::atomic<long> all_allocations(0);
+
+void* operator new(size_t size)
+{
+    if (counting) {
+        ++allocations;
+    }
+    if (counting_all.load(std::memory_order_relaxed)) {
+        all_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main()
+{
+    // Small captures inline, move only captures accepted.
+    auto owned = std::make_unique<int>(7);
+    int seen = 0;
+    xg::timer::Task::Callback moved([&seen, value = std::move(owned)]() { seen = *value; });
+    xg::timer::Task::Callback callback(std::move(moved));
+    callback();
+    char large[128] = { 1 };
+    auto big = [large, &seen]() { seen += large[0]; };
+    if (moved || seen != 7 || xg::timer::Task::Callback::IsInline<decltype(big)>()) {
+        xg::timer::Log::Error("TEST", "unique function mismatch");
+        return 1;
+    }
+    xg::timer::Task::Callback heap(big);
+    heap();
+
+    xg::timer::WheelManager manager(2);
+    manager.Start();
+    auto rule = std::make_shared<xg::timer::RuleDuration>(20ms);
+    std::atomic<int> fired(0);
+    std::atomic<long> sum(0);
+    std::atomic<int>* counter = &fired;
+    std::atomic<long>* total = &sum;
+    // Warm up, maps the first pool chunks.
+    manager.Schedule(rule, []() { }, false);
+
+    // Shared and by value rules, a duration is copied inline either way.
+    counting = true;
+    for (int index = 0; index < 500; ++index) {
+        xg::timer::TaskRule value = (index % 2) ? xg::timer::TaskRule(rule) : xg::timer::TaskRule(xg::timer::RuleDuration(20ms));
+        manager.Schedule(std::move(value), [counter, total, index]() {
+            counter->fetch_add(1);
+            total->fetch_add(index);
+        }, false);
+    }
+    counting = false;
+    long scheduled = allocations;
+
+    // Wall clock tasks are tracked by the worker without allocating either.
+    auto crontab_rule = std::make_shared<xg::timer::RuleCrontab>("* * * * * * *");
+    std::vector<std::shared_ptr<xg::timer::Task>> wall_tasks;
+    wall_tasks.reserve(200);
+    counting_all = true;
+    for (int index = 0; index < 200; ++index) {
+        wall_tasks.push_back(std::get<1>(manager.Schedule(crontab_rule, []() { })));
+    }
+    std::this_thread::sleep_for(50ms);
+    counting_all = false;
+    long wall_scheduled = all_allocations;
+    for (auto& task : wall_tasks) {
+        manager.Cancel(task);
+    }
+
+    std::this_thread::sleep_for(200ms);
+    manager.Stop();
+
+    xg::timer::TaskRule shared(std::static_pointer_cast<xg::timer::Rule>(rule));
+    xg::timer::TaskRule crontab(std::make_shared<xg::timer::RuleCrontab>("* * * * * * *"));
+    if (shared.IsExtension() || shared.IsWallClock() || crontab.IsExtension() || !crontab.IsWallClock() || xg::timer::TaskRule()) {
+        xg::timer::Log::Error("TEST", "task rule kind mismatch");
+        return 1;
+    }
+
+    xg::timer::Log::Info("TEST", "fired[", fired.load(), "] allocations[", scheduled, "] wall allocations[", wall_scheduled,
+            "] block[", xg::timer::TaskPool::BLOCK, "]");
+    if (fired != 500 || sum != 500 * 499 / 2 || scheduled || wall_scheduled) {
+        xg::timer::Log::Error("TEST", "pooled schedule mismatch");
+        return 1;
+    }
+    return 0;
+}
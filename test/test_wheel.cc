@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <set>
+#include "timer_log.hh"
+#include "timer_rule_duration.hh"
+#include "timer_rule_crontab.hh"
+#include "timer_wheel_manager.hh"
+
+using namespace std::chrono_literals;
+
+int main()
+{
+    xg::timer::WheelManager manager(2);
+    if (manager.SpreadNodes() != xg::timer::Return::SUCCESS) {
+        xg::timer::Log::Error("TEST", "pin workers failed");
+        return 1;
+    }
+    manager.Start();
+
+    // One shot timers fire once, not before their deadline.
+    std::atomic<int> once(0);
+    std::atomic<int> early(0);
+    auto begin = std::chrono::steady_clock::now();
+    for (int index = 0; index < 100; ++index) {
+        auto delay = std::chrono::milliseconds(10 + index);
+        manager.Schedule(std::make_shared<xg::timer::RuleDuration>(std::chrono::milliseconds(delay)), [&, delay]() {
+            if (std::chrono::steady_clock::now() - begin < delay) {
+                ++early;
+            }
+            ++once;
+        }, false);
+    }
+
+    std::atomic<int> periodic(0);
+    auto periodic_begin = std::chrono::steady_clock::now();
+    manager.Schedule(std::make_shared<xg::timer::RuleDuration>(20ms), [&]() { ++periodic; });
+
+    std::atomic<int> crontab(0);
+    manager.Schedule(std::make_shared<xg::timer::RuleCrontab>("* * * * * * *"), [&]() { ++crontab; });
+
+    std::atomic<int> cancelled(0);
+    auto task = std::get<1>(manager.Schedule(std::make_shared<xg::timer::RuleDuration>(500ms), [&]() { ++cancelled; }));
+    manager.Cancel(task);
+
+    // Timers with slack share slots, far fewer distinct fire ticks.
+    std::mutex mutex;
+    std::set<long long> slack_ticks;
+    std::atomic<int> slack_late(0);
+    for (int index = 0; index < 200; ++index) {
+        auto delay = std::chrono::milliseconds(100 + index);
+        manager.Schedule(std::make_shared<xg::timer::RuleDuration>(std::chrono::milliseconds(delay)), [&, delay]() {
+            auto elapsed = std::chrono::steady_clock::now() - begin;
+            if (elapsed < delay || elapsed > delay + 50ms + 20ms) {
+                ++slack_late;
+            }
+            std::scoped_lock lock(mutex);
+            slack_ticks.insert(std::chrono::duration_cast<std::chrono::milliseconds>(xg::timer::Clock::Now().time_since_epoch()).count());
+        }, false, 50ms);
+    }
+
+    // Groups cancel and move all members at once.
+    std::atomic<int> group_cancelled(0);
+    auto closed = manager.CreateGroup();
+    for (int index = 0; index < 5; ++index) {
+        manager.Schedule(closed, std::make_shared<xg::timer::RuleDuration>(50ms), [&]() { ++group_cancelled; });
+    }
+    manager.Cancel(closed);
+    if (std::get<0>(manager.Schedule(closed, std::make_shared<xg::timer::RuleDuration>(50ms), [](){})) != xg::timer::Return::EWHEEL_GROUP_CANCELLED) {
+        xg::timer::Log::Error("TEST", "schedule on a cancelled group accepted");
+        return 1;
+    }
+    std::atomic<int> group_moved(0);
+    std::atomic<int> group_early(0);
+    auto moved = manager.CreateGroup();
+    for (int index = 0; index < 3; ++index) {
+        manager.Schedule(moved, std::make_shared<xg::timer::RuleDuration>(100ms), [&]() {
+            if (std::chrono::steady_clock::now() - begin < 400ms) {
+                ++group_early;
+            }
+            ++group_moved;
+        }, false);
+    }
+    manager.Reschedule(moved, 300ms);
+
+    // Batch schedule, one bad entry, the rest land in their slots.
+    std::atomic<int> batch_fired(0);
+    std::atomic<int> batch_early(0);
+    std::vector<xg::timer::TaskSpec> specs;
+    for (int index = 0; index < 1000; ++index) {
+        auto delay = std::chrono::milliseconds(50 + index % 100);
+        specs.push_back({std::make_shared<xg::timer::RuleDuration>(std::chrono::milliseconds(delay)), [&, delay]() {
+            if (std::chrono::steady_clock::now() - begin < delay) {
+                ++batch_early;
+            }
+            ++batch_fired;
+        }, false, std::chrono::nanoseconds(0), (index % 10) ? nullptr : moved});
+    }
+    specs[500].rule = nullptr;
+    auto batch = manager.ScheduleBatch(specs);
+    if (std::get<0>(batch) != xg::timer::Return::ESCHEDULE_RULE_INVALID || std::get<1>(batch)[500] || !std::get<1>(batch)[501]) {
+        xg::timer::Log::Error("TEST", "batch schedule result mismatch");
+        return 1;
+    }
+    // An empty callback is rejected, the worker would call it.
+    if (std::get<0>(manager.Schedule(std::make_shared<xg::timer::RuleDuration>(10ms), xg::timer::Task::Callback(), false))
+            != xg::timer::Return::EWHEEL_TASK_INVALID) {
+        xg::timer::Log::Error("TEST", "empty callback accepted");
+        return 1;
+    }
+    std::vector<xg::timer::TaskSpec> empty_callback;
+    empty_callback.push_back({std::make_shared<xg::timer::RuleDuration>(10ms), xg::timer::Task::Callback(), false,
+                              std::chrono::nanoseconds(0), nullptr});
+    auto empty_batch = manager.ScheduleBatch(empty_callback);
+    if (std::get<0>(empty_batch) != xg::timer::Return::EWHEEL_TASK_INVALID || std::get<1>(empty_batch)[0]) {
+        xg::timer::Log::Error("TEST", "empty batch callback accepted");
+        return 1;
+    }
+
+    // A group of another manager is rejected, not indexed.
+    xg::timer::WheelManager other(1);
+    std::vector<xg::timer::TaskSpec> foreign;
+    foreign.push_back({std::make_shared<xg::timer::RuleDuration>(50ms), [](){}, false, std::chrono::nanoseconds(0), other.CreateGroup()});
+    auto foreign_batch = manager.ScheduleBatch(foreign);
+    if (std::get<0>(foreign_batch) != xg::timer::Return::EWHEEL_TASK_INVALID || std::get<1>(foreign_batch)[0]) {
+        xg::timer::Log::Error("TEST", "foreign group accepted");
+        return 1;
+    }
+
+    // Bulk crontab load on several threads, one bad rule.
+    std::atomic<int> loaded_fired(0);
+    std::vector<xg::timer::CrontabSpec> jobs;
+    for (int index = 0; index < 2000; ++index) {
+        jobs.push_back({"", (index % 3) ? "* * * * * * *" : "* * * * * * */1", (index % 2) ? "" : "UTC",
+                        [&]() { ++loaded_fired; }, false, std::chrono::nanoseconds(0), nullptr});
+    }
+    jobs[7].rule = "* * * * 24 0 0";
+    jobs[9].rule = "99999999999 * * * * * *";
+    auto loaded = manager.LoadCrontab(jobs, 4);
+    if (std::get<0>(loaded) != xg::timer::Return::ESCHEDULE_RULE_INVALID || std::get<1>(loaded)[7] || !std::get<1>(loaded)[8]
+            || std::get<1>(loaded)[9]) {
+        xg::timer::Log::Error("TEST", "crontab load result mismatch");
+        return 1;
+    }
+
+    // Reload only touches added, changed and removed jobs.
+    auto reload_jobs = [](std::vector<std::pair<std::string, std::string>> entries) {
+        std::vector<xg::timer::CrontabSpec> jobs;
+        for (auto& [id, rule] : entries) {
+            jobs.push_back({id, rule, "", [](){}, true, std::chrono::nanoseconds(0), nullptr});
+        }
+        return jobs;
+    };
+    auto live = reload_jobs({{"a", "* * * * * * *"}, {"b", "* * * * * * *"}, {"c", "* * * * * * *"}, {"e", "* * * * * * *"}});
+    auto before = std::get<1>(manager.Reload(live));
+    // A job whose task is gone is scheduled again even when unchanged.
+    manager.Cancel(before[3]);
+    auto next = reload_jobs({{"a", " * * *  * * * * "}, {"b", "* * * * * * */2"}, {"d", "* * * * * * *"}, {"d", "* * * * * * *"},
+                             {"e", "* * * * * * *"}});
+    auto reloaded = manager.Reload(next);
+    auto& after = std::get<1>(reloaded);
+    if (std::get<0>(reloaded) != xg::timer::Return::ESCHEDULE_RULE_CONFLICT || after[0] != before[0] || !after[1]
+            || after[1] == before[1] || before[1]->GetState() != xg::timer::TaskState::Cancelled
+            || before[2]->GetState() != xg::timer::TaskState::Cancelled || !after[2] || after[3]
+            || !after[4] || after[4] == before[3]) {
+        xg::timer::Log::Error("TEST", "crontab reload mismatch");
+        return 1;
+    }
+    std::vector<xg::timer::CrontabSpec> none;
+    manager.Reload(none);
+    for (auto& task : after) {
+        if (task && task->GetState() != xg::timer::TaskState::Cancelled) {
+            xg::timer::Log::Error("TEST", "crontab job not removed");
+            return 1;
+        }
+    }
+
+    // Bulk loaded jobs are live for a reload, unchanged ones keep their task
+    // and fire once. Loaded right after a second starts, nothing fires
+    // between the load and the reload.
+    while (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count() % 1000 > 100) {
+        std::this_thread::sleep_for(5ms);
+    }
+    std::atomic<int> kept_fired[50] = {};
+    auto kept_jobs = [&]() {
+        std::vector<xg::timer::CrontabSpec> jobs;
+        for (int index = 0; index < 50; ++index) {
+            jobs.push_back({std::to_string(index), "* * * * * * *", "", [&, index]() { ++kept_fired[index]; },
+                            false, std::chrono::nanoseconds(0), nullptr});
+        }
+        return jobs;
+    };
+    auto bulk = kept_jobs();
+    auto bulk_tasks = std::get<1>(manager.LoadCrontab(bulk));
+    auto again = kept_jobs();
+    auto again_tasks = std::get<1>(manager.Reload(again));
+    if (again_tasks != bulk_tasks) {
+        xg::timer::Log::Error("TEST", "bulk loaded jobs not kept by reload");
+        return 1;
+    }
+
+    // Idle timer kept alive by touches, fires once they stop.
+    std::atomic<int> idle(0);
+    std::atomic<int> idle_early(0);
+    auto idle_task = std::get<1>(manager.Schedule(std::make_shared<xg::timer::RuleDuration>(100ms), [&]() {
+        if (std::chrono::steady_clock::now() - begin < 400ms) {
+            ++idle_early;
+        }
+        ++idle;
+    }, false));
+    for (int index = 0; index < 15; ++index) {
+        std::this_thread::sleep_for(20ms);
+        manager.Touch(idle_task, 100ms);
+    }
+
+    std::this_thread::sleep_for(1200ms);
+
+    // Cheap clock reads stay on the steady time base.
+    auto& clock = xg::timer::Clock::Instance();
+    auto now = xg::timer::Clock::Now();
+    for (auto read : {clock.Cached(), clock.Fast(), xg::timer::Clock::Coarse()}) {
+        if (std::chrono::abs(read - now) > 20ms) {
+            xg::timer::Log::Error("TEST", "clock read off by [", (read - now).count(), "] ns");
+            return 1;
+        }
+    }
+    if (batch_fired != 999 || batch_early) {
+        xg::timer::Log::Error("TEST", "batch mismatch fired[", batch_fired.load(), "] early[", batch_early.load(), "]");
+        return 1;
+    }
+    for (auto& fired : kept_fired) {
+        if (fired != 1) {
+            xg::timer::Log::Error("TEST", "reloaded job fired[", fired.load(), "]");
+            return 1;
+        }
+    }
+    if (loaded_fired != 1998) {
+        xg::timer::Log::Error("TEST", "crontab load fired[", loaded_fired.load(), "]");
+        return 1;
+    }
+    if (idle != 1 || idle_early) {
+        xg::timer::Log::Error("TEST", "idle timer mismatch fired[", idle.load(), "] early[", idle_early.load(), "]");
+        return 1;
+    }
+    if (group_cancelled || closed->Size() || group_moved != 3 || group_early || moved->Size()) {
+        xg::timer::Log::Error("TEST", "group mismatch cancelled[", group_cancelled.load(), "] moved[", group_moved.load(),
+                "] early[", group_early.load(), "]");
+        return 1;
+    }
+    manager.Stop();
+    // Fires every 20ms from the schedule until the stop, never ahead.
+    int periodic_expected = (int)((std::chrono::steady_clock::now() - periodic_begin) / 20ms);
+
+    // Small coarse wheel, 10ms ticks and a 16 * 16 * 16 tick horizon.
+    xg::timer::WheelManager coarse(1, xg::timer::WheelGeometry(10ms, 4, 3));
+    coarse.Start();
+    std::atomic<int> coarse_fired(0);
+    auto coarse_begin = std::chrono::steady_clock::now();
+    if (std::get<0>(coarse.Schedule(std::make_shared<xg::timer::RuleDuration>(35ms), [](){})) != xg::timer::Return::ESCHEDULE_RULE_INVALID) {
+        xg::timer::Log::Error("TEST", "duration finer than the tick accepted");
+        return 1;
+    }
+    coarse.Schedule(std::make_shared<xg::timer::RuleDuration>(170ms), [&]() {
+        if (std::chrono::steady_clock::now() - coarse_begin >= 170ms) {
+            ++coarse_fired;
+        }
+    }, false);
+    // Past the 40.96s horizon, waits in the overflow heap until cancelled.
+    std::atomic<int> far_fired(0);
+    auto far = std::get<1>(coarse.Schedule(std::make_shared<xg::timer::RuleDuration>(60s), [&]() { ++far_fired; }));
+    std::this_thread::sleep_for(300ms);
+    coarse.Cancel(far);
+    coarse.Stop();
+    if (far_fired) {
+        xg::timer::Log::Error("TEST", "far timer fired early");
+        return 1;
+    }
+    if (coarse_fired != 1) {
+        xg::timer::Log::Error("TEST", "coarse wheel fire mismatch");
+        return 1;
+    }
+
+    // Cancels from several threads race the worker firing, lock free.
+    xg::timer::WheelManager racing(2);
+    racing.Start();
+    std::atomic<int> race_fired(0);
+    std::vector<std::shared_ptr<xg::timer::Task>> race_tasks;
+    for (int index = 0; index < 400; ++index) {
+        race_tasks.push_back(std::get<1>(racing.Schedule(std::make_shared<xg::timer::RuleDuration>(2ms), [&]() { ++race_fired; })));
+    }
+    std::this_thread::sleep_for(50ms);
+    std::vector<std::thread> cancellers;
+    for (int thread = 0; thread < 4; ++thread) {
+        cancellers.emplace_back([&, thread]() {
+            for (size_t index = thread; index < race_tasks.size(); index += 4) {
+                racing.Cancel(race_tasks[index]);
+            }
+        });
+    }
+    for (auto& thread : cancellers) {
+        thread.join();
+    }
+    // A callback running right at its cancel may still complete.
+    std::this_thread::sleep_for(10ms);
+    int race_snapshot = race_fired;
+    std::this_thread::sleep_for(50ms);
+    racing.Stop();
+    for (auto& task : race_tasks) {
+        if (task->GetState() != xg::timer::TaskState::Cancelled) {
+            xg::timer::Log::Error("TEST", "task not cancelled");
+            return 1;
+        }
+    }
+    if (!race_snapshot || race_fired != race_snapshot) {
+        xg::timer::Log::Error("TEST", "fired after cancel [", race_fired.load() - race_snapshot, "]");
+        return 1;
+    }
+
+    // Adds still queued at a stop are kept and fire after the restart.
+    xg::timer::WheelManager restarted(1);
+    restarted.Start();
+    // Keeps the worker busy so the adds below are still queued at the stop.
+    restarted.Schedule(std::make_shared<xg::timer::RuleDuration>(5ms), []() { std::this_thread::sleep_for(100ms); }, false);
+    std::this_thread::sleep_for(30ms);
+    std::atomic<int> restart_fired(0);
+    for (int index = 0; index < 1000; ++index) {
+        restarted.Schedule(std::make_shared<xg::timer::RuleDuration>(20ms), [&]() { ++restart_fired; }, false);
+    }
+    restarted.Stop();
+    restarted.Start();
+    std::this_thread::sleep_for(100ms);
+    restarted.Stop();
+    if (restart_fired != 1000) {
+        xg::timer::Log::Error("TEST", "restart lost tasks fired[", restart_fired.load(), "]");
+        return 1;
+    }
+
+    xg::timer::Log::Info("TEST", "once[", once.load(), "] early[", early.load(), "] periodic[", periodic.load(),
+            "/", periodic_expected, "] crontab[", crontab.load(), "] cancelled[", cancelled.load(), "]");
+    xg::timer::Log::Info("TEST", "slack ticks[", slack_ticks.size(), "] out of window[", slack_late.load(), "]");
+    if (slack_ticks.size() > 40 || slack_late) {
+        xg::timer::Log::Error("TEST", "slack timers not coalesced");
+        return 1;
+    }
+    if (once != 100 || early || periodic * 3 < periodic_expected * 2 || periodic > periodic_expected || crontab < 1 || crontab > 2 || cancelled) {
+        xg::timer::Log::Error("TEST", "wheel fire mismatch");
+        return 1;
+    }
+    return 0;
+}
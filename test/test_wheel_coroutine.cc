@@ -0,0 +1,62 @@
+#include <algorithm>
+#include "timer_log.hh"
+#include "timer_rule_crontab.hh"
+#include "timer_wheel_manager.hh"
+
+using namespace std::chrono_literals;
+
+// Minimal eager, detached coroutine.
+struct Job {
+    struct promise_type {
+        Job get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() { }
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+Job sleeper(xg::timer::WheelManager& manager, std::atomic<int>& result)
+{
+    auto begin = std::chrono::steady_clock::now();
+    for (int index = 0; index < 3; ++index) {
+        co_await manager.SleepFor(50ms);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    co_await manager.SleepUntil(xg::timer::Clock::Now() - 1s);
+    result = (elapsed >= 150ms && elapsed < 300ms) ? 1 : -1;
+}
+
+Job cron(xg::timer::WheelManager& manager, std::atomic<int>& result)
+{
+    auto ret = co_await manager.NextFire(std::make_shared<xg::timer::RuleCrontab>("* * * * * * *"));
+    auto lag = std::chrono::system_clock::now() - std::get<1>(ret);
+    result = (std::get<0>(ret) == xg::timer::Return::SUCCESS && lag >= 0s && lag < 100ms) ? 1 : -1;
+}
+
+Job expired(xg::timer::WheelManager& manager, std::atomic<int>& result)
+{
+    auto ret = co_await manager.NextFire(std::make_shared<xg::timer::RuleCrontab>("2020 * * * * * *"));
+    result = (std::get<0>(ret) == xg::timer::Return::ESCHEDULE_RULE_REACH_LIMIT) ? 1 : -1;
+}
+
+int main()
+{
+    xg::timer::WheelManager manager(2);
+    manager.Start();
+
+    std::atomic<int> sleep_result(0);
+    std::atomic<int> cron_result(0);
+    std::atomic<int> expired_result(0);
+    sleeper(manager, sleep_result);
+    cron(manager, cron_result);
+    expired(manager, expired_result);
+
+    for (int wait = 0; wait < 30 && (!sleep_result || !cron_result || !expired_result); ++wait) {
+        std::this_thread::sleep_for(100ms);
+    }
+    manager.Stop();
+
+    xg::timer::Log::Info("TEST", "sleep[", sleep_result.load(), "] cron[", cron_result.load(), "] expired[", expired_result.load(), "]");
+    return (sleep_result == 1 && cron_result == 1 && expired_result == 1) ? 0 : 1;
+}